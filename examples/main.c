@@ -5,7 +5,7 @@
 
 #include "simjson.h"
 
-//OBJECT_BUCKET_SIZE为object内部哈希表的初始大小
+//OBJECT_BUCKET_SIZE为object预计的键值对数量，哈希表按此预留容量，超出时自动扩容
 #define OBJECT_BUCKET_SIZE 128
 
 /*
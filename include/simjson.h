@@ -8,8 +8,10 @@
 #include "simjson_null.h"
 #include "simjson_array.h"
 #include "simjson_object.h"
+#include "simjson_schema.h"
 #include "simjson_encode.h"
 #include "simjson_decode.h"
+#include "simjson_writer.h"
 #include "simjson_type.h"
 
 #endif //SIMJSON_SIMJSON_H
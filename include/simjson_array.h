@@ -17,6 +17,7 @@ typedef struct {
     SimjsonArrayItem *head;
     SimjsonArrayItem *tail;
     size_t size;
+    SimjsonEncodeCache cache;
 } SimjsonArray;
 
 typedef struct {
@@ -48,6 +49,10 @@ SIMJSON_PUBLIC bool simjson_array_delete(SimjsonArray *array, size_t index);
 //创建迭代器
 SIMJSON_PUBLIC SimjsonArrayIterator *simjson_array_iterator_new(SimjsonArray *array, size_t start_index);
 
+//在调用者提供的存储(如栈上)初始化迭代器，无需释放
+SIMJSON_PUBLIC bool simjson_array_iterator_init(SimjsonArrayIterator *iterator, SimjsonArray *array,
+                                                size_t start_index);
+
 //释放迭代器
 SIMJSON_PUBLIC void simjson_array_iterator_free(SimjsonArrayIterator *iterator);
 
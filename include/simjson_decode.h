@@ -1,7 +1,10 @@
 #ifndef SIMJSON_DECODE_H
 #define SIMJSON_DECODE_H
 
+#include <stdbool.h>
+
 #include "simjson_scope.h"
+#include "simjson_schema.h"
 
 /*
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
@@ -10,6 +13,16 @@
 //接收json字符串，返回json对象
 SIMJSON_PUBLIC void *simjson_decode(const char *json_str, size_t length);
 
+//原地解码：字符串与object键在json_str内原地反转义，解码结果直接指向json_str，不再逐个拷贝
+//json_str会被修改，调用者需保证其生命周期长于返回的json对象
+SIMJSON_PUBLIC void *simjson_decode_insitu(char *json_str, size_t length);
+
+//按schema将json object直接解码到struct_ptr指向的结构体，不创建中间json对象
+//结构体先被清零，缺失的键与值为null的字段保持零值，schema中不存在的键被跳过
+//失败时返回false，并释放已分配的字段
+SIMJSON_PUBLIC bool simjson_decode_into(const SimjsonSchema *schema, void *struct_ptr, const char *json_str,
+                                        size_t length);
+
 /*
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
  */
@@ -1,16 +1,100 @@
 #ifndef SIMJSON_ENCODE_H
 #define SIMJSON_ENCODE_H
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
 #include "simjson_scope.h"
+#include "simjson_schema.h"
+
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ */
+
+//编码输出模式
+#define SIMJSON_ENCODE_DEFAULT 0   //与simjson_encode相同，以", "与": "分隔
+#define SIMJSON_ENCODE_COMPACT 1   //不含任何空白，体积最小
+#define SIMJSON_ENCODE_PRETTY 2    //换行并缩进
+#define SIMJSON_ENCODE_CANONICAL 3 //不含空白且object的键按字节序排序，相同内容总是输出相同的字节
+
+typedef struct {
+    uint8_t mode;
+    //SIMJSON_ENCODE_PRETTY每层缩进的空格数，为0时使用4
+    uint8_t indent;
+} SimjsonEncodeOptions;
+
+//聚集写的编码结果，由simjson_encode_gather创建
+typedef struct SimjsonGather SimjsonGather;
+
+//输出回调，接收一段已编码的json，返回false表示输出失败并中止编码
+typedef bool (*SimjsonSink)(void *ctx, const char *data, size_t length);
 
 /*
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
  */
 
 //接收json对象，返回json字符串
+//先计算精确长度并一次性分配缓冲区，返回的即是该缓冲区，不再额外拷贝
 //调用者负责free返回的字符串
 SIMJSON_PUBLIC char *simjson_encode(void *json_struct, size_t *json_str_length);
 
+//按options指定的模式编码，options为NULL时与simjson_encode相同
+//调用者负责free返回的字符串
+SIMJSON_PUBLIC char *simjson_encode_ex(void *json_struct, const SimjsonEncodeOptions *options,
+                                       size_t *json_str_length);
+
+//多线程编码，顶层array或object的元素被均分为thread_count段分别编码后按顺序拼接
+//顶层只有一个元素时（如{"data": [...]}）逐层向内，拆分第一个有多个元素的容器
+//各段由常驻线程池执行，线程在首次调用时按在线CPU数创建，之后的调用不再创建线程
+//输出与simjson_encode_ex逐字节相同；thread_count为0时使用在线CPU数，元素过少或有可复用的缓存时退化为单线程
+//调用者负责free返回的字符串
+SIMJSON_PUBLIC char *simjson_encode_parallel(void *json_struct, const SimjsonEncodeOptions *options,
+                                             size_t thread_count, size_t *json_str_length);
+
+//计算json对象编码后的精确长度(不含'\0')，包括转义与数字位数，失败时返回0
+SIMJSON_PUBLIC size_t simjson_encoded_size(void *json_struct);
+
+//将json对象编码到调用者提供的缓冲区，不分配内存
+//needed不为NULL时写入json长度(不含'\0')，无论缓冲区是否足够
+//缓冲区能容纳json与结尾的'\0'时返回true；空间不足时返回false，此时缓冲区内容未定义
+//可先以buf == NULL, size == 0调用获取长度，再分配needed + 1字节
+SIMJSON_PUBLIC bool simjson_encode_into(void *json_struct, char *buf, size_t size, size_t *needed);
+
+//流式编码：输出写入固定大小的缓冲区，写满即交给sink，内存占用与json大小无关
+//使用两块缓冲区，sink在后台线程中输出一块时编码继续写入另一块；sink的调用按顺序进行，不会并发
+//sink返回false时中止编码并返回false，此时sink可能已收到部分输出
+SIMJSON_PUBLIC bool simjson_encode_to_sink(void *json_struct, SimjsonSink sink, void *sink_ctx);
+
+//流式编码到文件描述符，处理部分写入与EINTR
+//写入普通文件时write在数据进入页缓存后即返回，落盘由内核异步完成，与编码过程重叠
+SIMJSON_PUBLIC bool simjson_encode_to_fd(void *json_struct, int fd);
+
+//聚集写编码：标点与短值生成到内部缓冲区，长且无需转义的字符串值直接引用SimjsonString的内存而不拷贝
+//结果引用json对象内部的数据，在simjson_gather_free之前不能修改或释放json对象
+SIMJSON_PUBLIC SimjsonGather *simjson_encode_gather(void *json_struct, const SimjsonEncodeOptions *options);
+
+//按输出顺序排列的iovec数组，可直接交给writev/sendmsg，在simjson_gather_free之前有效
+SIMJSON_PUBLIC const struct iovec *simjson_gather_iovec(const SimjsonGather *gather, size_t *count);
+
+//所有iovec的总字节数
+SIMJSON_PUBLIC size_t simjson_gather_length(const SimjsonGather *gather);
+
+//以writev写出全部内容，iovec过多时分批提交，处理部分写入与EINTR
+SIMJSON_PUBLIC bool simjson_gather_write(const SimjsonGather *gather, int fd);
+
+SIMJSON_PUBLIC void simjson_gather_free(SimjsonGather *gather);
+
+//按schema直接编码struct_ptr指向的结构体，不创建中间json对象
+//字段按schema声明顺序输出，调用者负责free返回的字符串
+SIMJSON_PUBLIC char *simjson_encode_from(const SimjsonSchema *schema, const void *struct_ptr,
+                                         size_t *json_str_length);
+
+//按options指定的格式编码，canonical模式下字段按名称的字节序输出；options为NULL时与simjson_encode_from相同
+SIMJSON_PUBLIC char *simjson_encode_from_ex(const SimjsonSchema *schema, const void *struct_ptr,
+                                            const SimjsonEncodeOptions *options, size_t *json_str_length);
+
 /*
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
  */
@@ -11,19 +11,42 @@
  */
 
 typedef struct SimjsonObjectItem SimjsonObjectItem;
+typedef struct SimjsonObjectFrozen SimjsonObjectFrozen;
 
 typedef struct {
     SIMJSON_TYPE type;
-    SimjsonObjectItem **buckets;
-    size_t bucket_size;
+    //按插入顺序紧凑存放的键值对，删除留下的空位在重建索引表时压缩
+    SimjsonObjectItem *items;
+    //items中已使用的位置数，含已删除的空位
+    size_t item_count;
     size_t item_size;
+    //索引表，每个槽位一个控制字节：空、已删除，或键哈希的低7位
+    //键值对较少时为NULL，此时不建索引，线性查找items
+    uint8_t *ctrl;
+    //与ctrl一一对应，槽位上的键值对在items中的下标
+    uint32_t *slots;
+    //索引表的槽位数，为2的幂且不小于16，items容量为其7/8；不建索引时为items的容量
+    size_t capacity;
+    //simjson_object_freeze之后的只读索引，不为NULL时不能再添加或删除键值对
+    SimjsonObjectFrozen *frozen;
+    SimjsonEncodeCache cache;
 } SimjsonObject;
 
+//预先计算好哈希的键，用于在大量object中反复查找同一个键
+//哈希使用进程级随机种子，句柄不能跨进程保存
+typedef struct {
+    const char *key;
+    size_t key_length;
+    uint64_t hash;
+} SimjsonKey;
+
 typedef struct {
     SimjsonObject *object;
-    SimjsonObjectItem *cur_item;
+    //上一次simjson_object_iterator_next返回的键值对
+    SimjsonObjectItem *last_item;
     size_t cur_item_index;
-    size_t cur_bucket_index;
+    //items中下一个要检查的位置
+    size_t cur_entry_index;
 } SimjsonObjectIterator;
 
 /*
@@ -31,7 +54,24 @@ typedef struct {
  */
 
 //创建新的object对象
-SIMJSON_PUBLIC SimjsonObject *simjson_object_new(size_t bucket_size);
+//capacity为预计的键值对数量，用于避免扩容
+//不超过8时先以线性数组存放，首次添加时才分配，超过后自动转为哈希表
+SIMJSON_PUBLIC SimjsonObject *simjson_object_new(size_t capacity);
+
+//一次性由count个键值对创建object，键被拷贝，值由object接管，键值对保持给定的顺序
+//unique为true时调用者保证键互不重复，跳过重复检查
+//失败时返回NULL，值仍归调用者
+SIMJSON_PUBLIC SimjsonObject *simjson_object_from_entries(const char *const *keys, const size_t *key_lengths,
+                                                          void *const *values, size_t count, bool unique);
+
+//预留空间，使object容纳item_size个键值对之前不再扩容
+SIMJSON_PUBLIC bool simjson_object_reserve(SimjsonObject *object, size_t item_size);
+
+//冻结object，此后添加、删除与预留都会失败
+//以最小完美哈希替代索引表，查找只需一次哈希与一次键比较；单独分配的键拼接到一块连续内存
+//只冻结object自身，值中的object需要分别冻结
+//构建失败时返回false，object保持可修改
+SIMJSON_PUBLIC bool simjson_object_freeze(SimjsonObject *object);
 
 //释放object对象
 SIMJSON_PUBLIC void simjson_object_free(SimjsonObject *object);
@@ -39,24 +79,70 @@ SIMJSON_PUBLIC void simjson_object_free(SimjsonObject *object);
 //添加键值对
 SIMJSON_PUBLIC bool simjson_object_add(SimjsonObject *object, const char *key, size_t key_length, void *json_struct);
 
+//添加键值对，键不拷贝
+//调用者保证key的生命周期长于object对象
+SIMJSON_PUBLIC bool simjson_object_add_borrowed(SimjsonObject *object, const char *key, size_t key_length, void *json_struct);
+
 //获取键对应的值
 SIMJSON_PUBLIC void *simjson_object_get(SimjsonObject *object, const char *key, size_t key_length);
 
+//插入或替换键对应的值，只查找一次
+//替换时old_json_struct不为NULL则返回旧值，由调用者释放，否则直接释放旧值
+SIMJSON_PUBLIC bool simjson_object_set(SimjsonObject *object, const char *key, size_t key_length, void *json_struct,
+                                       void **old_json_struct);
+
+//移除键值对并返回值，值不释放而交给调用者，键不存在时返回NULL
+SIMJSON_PUBLIC void *simjson_object_take(SimjsonObject *object, const char *key, size_t key_length);
+
+//返回键对应的值所在的位置，键不存在时先插入json_struct，只查找一次，*inserted表示是否插入
+//json_struct可以为NULL，插入后由调用者经由位置写入值，键已存在时json_struct不被使用，仍归调用者
+//位置在object下次修改前有效；经由位置写入或替换值后须调用simjson_object_slot_commit，替换时旧值由调用者释放
+SIMJSON_PUBLIC void **simjson_object_get_or_insert_slot(SimjsonObject *object, const char *key, size_t key_length,
+                                                        void *json_struct, bool *inserted);
+
+//提交经由位置写入的值：记录子容器的parent，并使object及其祖先的编码缓存失效
+//位置上的值仍为NULL时撤销这次插入；在提交之前不能对object做其他操作
+SIMJSON_PUBLIC bool simjson_object_slot_commit(SimjsonObject *object, void **slot);
+
+//创建键句柄，不拷贝key，调用者保证key的生命周期长于句柄
+SIMJSON_PUBLIC SimjsonKey simjson_key_make(const char *key, size_t key_length);
+
+//以键句柄获取键对应的值，不再计算键的哈希
+SIMJSON_PUBLIC void *simjson_object_get_k(SimjsonObject *object, const SimjsonKey *key);
+
 //删除键值对
 SIMJSON_PUBLIC bool simjson_object_delete(SimjsonObject *object, const char *key, size_t key_length);
 
 //创建迭代器
 SIMJSON_PUBLIC SimjsonObjectIterator *simjson_object_iterator_new(SimjsonObject *object);
 
+//在调用者提供的存储(如栈上)初始化迭代器，无需释放
+SIMJSON_PUBLIC bool simjson_object_iterator_init(SimjsonObjectIterator *iterator, SimjsonObject *object);
+
 //释放迭代器
 SIMJSON_PUBLIC void simjson_object_iterator_free(SimjsonObjectIterator *iterator);
 
 //迭代器是否还有下一个元素
 SIMJSON_PUBLIC bool simjson_object_iterator_has_next(SimjsonObjectIterator *iterator);
 
-//获取迭代器的下一个元素
+//获取迭代器的下一个元素，按键的插入顺序返回
+//迭代过程中不能修改object
 SIMJSON_PUBLIC void *simjson_object_iterator_next(SimjsonObjectIterator *iterator, char **key, size_t *key_length);
 
+//上一次simjson_object_iterator_next返回的键的已转义片段"\"key\": "，不以'\0'结尾
+//片段在插入时生成，这里只读取，多个线程可以同时编码同一个object
+SIMJSON_PUBLIC const char *simjson_object_iterator_key_fragment(const SimjsonObjectIterator *iterator,
+                                                                size_t *length);
+
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ */
+
+//按RFC 7396将patch合并到*target，patch中的节点直接移入target而不拷贝，代价与patch的大小成正比
+//除参数为NULL外patch总是被接管；patch或*target不是object时*target被整体替换
+//需要修改冻结的object时在修改前失败，*target保持不变；内存分配失败时*target仍是完整的json，但patch可能只应用了一部分
+SIMJSON_PUBLIC bool simjson_merge_patch(void **target, void *patch);
+
 /*
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
  */
@@ -0,0 +1,89 @@
+#ifndef SIMJSON_SCHEMA_H
+#define SIMJSON_SCHEMA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "simjson_scope.h"
+
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ */
+
+//字段类型，决定结构体中对应成员的C类型
+#define SIMJSON_FIELD_INT64 0   //int64_t
+#define SIMJSON_FIELD_INT32 1   //int32_t
+#define SIMJSON_FIELD_DOUBLE 2  //double
+#define SIMJSON_FIELD_BOOLEAN 3 //bool
+#define SIMJSON_FIELD_STRING 4  //char *，以'\0'结尾，json为null时写入NULL，由simjson_schema_free释放
+#define SIMJSON_FIELD_CHARS 5   //char[size]，内联存储，超出容量视为错误
+#define SIMJSON_FIELD_OBJECT 6  //内嵌结构体，由schema描述
+#define SIMJSON_FIELD_ARRAY 7   //元素指针，元素类型为element_type，元素数量(size_t)位于count_offset，由simjson_schema_free释放
+
+typedef struct SimjsonSchema SimjsonSchema;
+
+typedef struct {
+    const char *name;
+    size_t name_length;
+    uint8_t type;
+    size_t offset;
+    //SIMJSON_FIELD_CHARS的容量
+    size_t size;
+    //SIMJSON_FIELD_OBJECT或元素为SIMJSON_FIELD_OBJECT的SIMJSON_FIELD_ARRAY
+    const SimjsonSchema *schema;
+    //SIMJSON_FIELD_ARRAY的元素类型，不支持SIMJSON_FIELD_CHARS与SIMJSON_FIELD_ARRAY
+    uint8_t element_type;
+    size_t count_offset;
+    //编码时使用的预转义键片段，如"\"name\": "，为NULL时由name现场转义
+    const char *key_fragment;
+    size_t key_fragment_length;
+} SimjsonField;
+
+struct SimjsonSchema {
+    const SimjsonField *fields;
+    size_t field_count;
+    size_t struct_size;
+};
+
+//成员名是C标识符，无需转义，键片段在编译期拼接
+#define SIMJSON_SCHEMA_KEY_FRAGMENT(member) "\"" #member "\": ", sizeof("\"" #member "\": ") - 1
+
+//以成员名作为json键
+#define SIMJSON_SCHEMA_FIELD(struct_type, member, field_type) \
+    {#member, sizeof(#member) - 1, field_type, offsetof(struct_type, member), 0, NULL, 0, 0, \
+     SIMJSON_SCHEMA_KEY_FRAGMENT(member)}
+
+#define SIMJSON_SCHEMA_CHARS(struct_type, member) \
+    {#member, sizeof(#member) - 1, SIMJSON_FIELD_CHARS, offsetof(struct_type, member), \
+     sizeof(((struct_type *) 0)->member), NULL, 0, 0, SIMJSON_SCHEMA_KEY_FRAGMENT(member)}
+
+#define SIMJSON_SCHEMA_OBJECT(struct_type, member, nested_schema) \
+    {#member, sizeof(#member) - 1, SIMJSON_FIELD_OBJECT, offsetof(struct_type, member), 0, &(nested_schema), 0, 0, \
+     SIMJSON_SCHEMA_KEY_FRAGMENT(member)}
+
+//元素不是object时nested_schema传NULL
+#define SIMJSON_SCHEMA_ARRAY(struct_type, member, count_member, element_field_type, nested_schema) \
+    {#member, sizeof(#member) - 1, SIMJSON_FIELD_ARRAY, offsetof(struct_type, member), 0, nested_schema, \
+     element_field_type, offsetof(struct_type, count_member), SIMJSON_SCHEMA_KEY_FRAGMENT(member)}
+
+#define SIMJSON_SCHEMA(struct_type, field_array) \
+    {field_array, sizeof(field_array) / sizeof((field_array)[0]), sizeof(struct_type)}
+
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ */
+
+//数组元素的字节大小，不支持的元素类型返回0
+SIMJSON_PUBLIC size_t simjson_schema_element_size(uint8_t element_type, const SimjsonSchema *schema);
+
+//释放结构体内由simjson_decode_into分配的字符串与数组，不释放struct_ptr本身
+SIMJSON_PUBLIC void simjson_schema_free(const SimjsonSchema *schema, void *struct_ptr);
+
+//释放单个字段持有的内存并将其恢复为零值，数组字段的元素数量同时置0
+SIMJSON_PUBLIC void simjson_schema_field_reset(const SimjsonField *field, void *struct_ptr);
+
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ */
+
+#endif //SIMJSON_SCHEMA_H
@@ -2,6 +2,7 @@
 #define SIMJSON_STRING_H
 
 #include <string.h>
+#include <stdbool.h>
 
 #include "simjson_type.h"
 #include "simjson_scope.h"
@@ -14,6 +15,8 @@ typedef struct {
     SIMJSON_TYPE type;
     size_t length;
     char *value;
+    //value是否借用自外部缓冲区(如原地解码的输入)，借用时释放string不会释放value
+    bool borrowed;
 } SimjsonString;
 
 /*
@@ -23,6 +26,10 @@ typedef struct {
 //创建新的string对象
 SIMJSON_PUBLIC SimjsonString *simjson_string_new(const char *value, size_t length);
 
+//创建新的string对象，value不拷贝
+//调用者保证value以'\0'结尾，且生命周期长于string对象
+SIMJSON_PUBLIC SimjsonString *simjson_string_new_borrowed(char *value, size_t length);
+
 //释放string对象
 SIMJSON_PUBLIC void simjson_string_free(SimjsonString *string);
 
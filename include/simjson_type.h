@@ -2,6 +2,7 @@
 #define SIMJSON_TYPE_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #include "simjson_scope.h"
@@ -15,13 +16,59 @@
 #define SIMJSON_ARRAY_TYPE 4
 #define SIMJSON_OBJECT_TYPE 5
 
-#define SIMJSON_IS_STRING_TYPE(json_struct) !(json_struct) ? 0 : ((((unsigned) ((uint8_t *) (json_struct))[0]) == 0))
-#define SIMJSON_IS_NUMBER_TYPE(json_struct) !(json_struct) ? 0 : ((((unsigned) ((uint8_t *) (json_struct))[0]) == 1))
-#define SIMJSON_IS_BOOLEAN_TYPE(json_struct) !(json_struct) ? 0 : ((((unsigned) ((uint8_t *) (json_struct))[0]) == 2))
-#define SIMJSON_IS_NULL_TYPE(json_struct) !(json_struct) ? 0 : ((((unsigned) ((uint8_t *) (json_struct))[0]) == 3))
-#define SIMJSON_IS_ARRAY_TYPE(json_struct) !(json_struct) ? 0 : ((((unsigned) ((uint8_t *) (json_struct))[0]) == 4))
-#define SIMJSON_IS_OBJECT_TYPE(json_struct) !(json_struct) ? 0 : ((((unsigned) ((uint8_t *) (json_struct))[0]) == 5))
+#define SIMJSON_IS_STRING_TYPE(json_struct) (!(json_struct) ? 0 : ((((unsigned) ((uint8_t *) (json_struct))[0]) == 0)))
+#define SIMJSON_IS_NUMBER_TYPE(json_struct) (!(json_struct) ? 0 : ((((unsigned) ((uint8_t *) (json_struct))[0]) == 1)))
+#define SIMJSON_IS_BOOLEAN_TYPE(json_struct) (!(json_struct) ? 0 : ((((unsigned) ((uint8_t *) (json_struct))[0]) == 2)))
+#define SIMJSON_IS_NULL_TYPE(json_struct) (!(json_struct) ? 0 : ((((unsigned) ((uint8_t *) (json_struct))[0]) == 3)))
+#define SIMJSON_IS_ARRAY_TYPE(json_struct) (!(json_struct) ? 0 : ((((unsigned) ((uint8_t *) (json_struct))[0]) == 4)))
+#define SIMJSON_IS_OBJECT_TYPE(json_struct) (!(json_struct) ? 0 : ((((unsigned) ((uint8_t *) (json_struct))[0]) == 5)))
+
+//父容器的缓存在offset处引用子容器的缓存，不拷贝子容器的字节
+typedef struct {
+    size_t offset;
+    void *child;
+} SimjsonEncodeCacheRef;
+
+//array与object共用的编码缓存
+//每个容器只保存自身的字节，已缓存的子容器由refs引用，整棵树的缓存共占O(输出长度)的内存
+typedef struct {
+    //所在的容器，根节点为NULL，用于向上传播失效
+    void *parent;
+    //自身的编码结果，不含refs引用的子容器，为NULL表示尚未缓存或已失效
+    char *encoded;
+    size_t own_length;
+    //按offset升序，offset为在encoded中的位置
+    SimjsonEncodeCacheRef *refs;
+    size_t ref_count;
+    //包含子容器在内的完整输出长度
+    size_t encoded_length;
+    //缓存对应的输出格式
+    uint8_t format;
+    bool enabled;
+} SimjsonEncodeCache;
 
 SIMJSON_PUBLIC void simjson_free_json_struct(void *json_struct);
 
+//容器的编码缓存，标量返回NULL
+SIMJSON_PUBLIC SimjsonEncodeCache *simjson_encode_cache_of(void *json_struct);
+
+//为json_struct及其所有子容器启用编码缓存，之后加入的子容器自动启用
+//未修改的子树再次编码时直接复用缓存的字节，代价与修改路径成正比
+//只缓存紧凑格式（默认、compact与canonical）的输出，美化输出每次完整编码
+//子树中有未启用缓存的容器时，其祖先不保存缓存
+SIMJSON_PUBLIC void simjson_encode_cache_enable(void *json_struct);
+
+//停用json_struct及其所有子容器的编码缓存并释放缓存
+SIMJSON_PUBLIC void simjson_encode_cache_disable(void *json_struct);
+
+//使json_struct及其所有祖先的缓存失效，遇到已失效的容器即停止，未启用缓存时代价为O(1)
+//array/object的增删会自动调用，直接修改标量的字段后需以其所在容器手动调用
+SIMJSON_PUBLIC void simjson_encode_cache_invalidate(void *json_struct);
+
+//释放容器自身的缓存而不影响祖先，供array/object与编码内部使用
+SIMJSON_PUBLIC void simjson_encode_cache_release(SimjsonEncodeCache *cache);
+
+//容器加入子节点后调用，记录子容器的parent并使容器的缓存失效，供array/object内部使用
+SIMJSON_PUBLIC void simjson_encode_cache_attach(void *container, void *child);
+
 #endif // SIMJSON_TYPE_H
@@ -0,0 +1,66 @@
+#ifndef SIMJSON_WRITER_H
+#define SIMJSON_WRITER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "simjson_scope.h"
+#include "simjson_encode.h"
+
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ */
+
+//最大嵌套深度
+#define SIMJSON_WRITER_MAX_DEPTH 256
+
+typedef struct SimjsonWriter SimjsonWriter;
+
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ */
+
+//创建writer，边写边输出json，不需要先构造json对象
+//sink为NULL时输出累积在可增长的缓冲区中，通过simjson_writer_data获取
+//sink不为NULL时缓冲区大小固定为buf_size，写满即交给sink，buf_size为0时使用默认大小
+SIMJSON_PUBLIC SimjsonWriter *simjson_writer_new(SimjsonSink sink, void *sink_ctx, size_t buf_size);
+
+//释放writer
+SIMJSON_PUBLIC void simjson_writer_free(SimjsonWriter *writer);
+
+//以下写入函数在用法错误(如object内缺少键、括号不匹配)或输出失败时返回false
+//出错后writer不再接受任何写入
+
+SIMJSON_PUBLIC bool simjson_writer_begin_object(SimjsonWriter *writer);
+
+SIMJSON_PUBLIC bool simjson_writer_end_object(SimjsonWriter *writer);
+
+SIMJSON_PUBLIC bool simjson_writer_begin_array(SimjsonWriter *writer);
+
+SIMJSON_PUBLIC bool simjson_writer_end_array(SimjsonWriter *writer);
+
+//写入object的键，之后必须写入一个值
+SIMJSON_PUBLIC bool simjson_writer_key(SimjsonWriter *writer, const char *key, size_t key_length);
+
+SIMJSON_PUBLIC bool simjson_writer_string(SimjsonWriter *writer, const char *value, size_t length);
+
+SIMJSON_PUBLIC bool simjson_writer_integer(SimjsonWriter *writer, int64_t value);
+
+SIMJSON_PUBLIC bool simjson_writer_double(SimjsonWriter *writer, double value);
+
+SIMJSON_PUBLIC bool simjson_writer_boolean(SimjsonWriter *writer, bool value);
+
+SIMJSON_PUBLIC bool simjson_writer_null(SimjsonWriter *writer);
+
+//结束写入：检查json是否完整，并将剩余输出交给sink
+SIMJSON_PUBLIC bool simjson_writer_finish(SimjsonWriter *writer);
+
+//未设置sink时获取已写入的json，以'\0'结尾，所有权仍属于writer
+SIMJSON_PUBLIC const char *simjson_writer_data(SimjsonWriter *writer, size_t *length);
+
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ */
+
+#endif //SIMJSON_WRITER_H
@@ -0,0 +1,454 @@
+#ifndef SIMJSON_JSON_BUF_H
+#define SIMJSON_JSON_BUF_H
+
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <stdio.h>
+#include <inttypes.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "simjson_encode.h"
+#include "log.h"
+
+//编码输出缓冲区，供encode与writer共用
+
+const static uint8_t GROW_FACTOR = 2;
+//足以容纳int64_t与"%g"格式的double
+#define NUMBER_BUF_SIZE 32
+
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ */
+
+//聚集写的一段输出，data为NULL时位于buf[offset, offset + length)，否则直接引用data
+typedef struct {
+    const char *data;
+    size_t offset;
+    size_t length;
+} JsonSegment;
+
+//buf[offset, offset + length)由owner输出，owner为NULL表示其中有未缓存的容器
+typedef struct {
+    const void *owner;
+    size_t offset;
+    size_t length;
+} JsonSpan;
+
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t length;
+    //sink不为NULL时，缓冲区满后交给sink输出而不是扩容，缓冲区大小保持不变
+    SimjsonSink sink;
+    void *sink_ctx;
+    //fixed为true时buf由调用者提供，不扩容也不释放，空间不足时只累计length
+    bool fixed;
+    //segments不为NULL时为聚集写模式，引用的数据不拷贝进buf，只记录为一段
+    JsonSegment *segments;
+    size_t segment_count;
+    size_t segment_capacity;
+    //buf中尚未记入segments的数据的起始位置
+    size_t segment_start;
+    //已写入buf的缓存子树，外层容器保存缓存时引用而不拷贝，按offset升序
+    JsonSpan *spans;
+    size_t span_count;
+    size_t span_capacity;
+} JsonBuf;
+
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ */
+
+SIMJSON_PRIVATE inline JsonBuf *json_buf_new(size_t initial_size, SimjsonSink sink, void *sink_ctx) {
+    JsonBuf *json_buf = malloc(sizeof(JsonBuf));
+    if (json_buf == NULL) {
+        DEBUG_INFO(strerror(errno));
+        return NULL;
+    }
+
+    json_buf->buf = malloc(initial_size);
+    if (json_buf->buf == NULL) {
+        DEBUG_INFO(strerror(errno));
+        free(json_buf);
+        return NULL;
+    }
+
+    json_buf->size = initial_size;
+    json_buf->length = 0;
+    json_buf->sink = sink;
+    json_buf->sink_ctx = sink_ctx;
+    json_buf->fixed = false;
+    json_buf->segments = NULL;
+    json_buf->segment_count = 0;
+    json_buf->segment_capacity = 0;
+    json_buf->segment_start = 0;
+    json_buf->spans = NULL;
+    json_buf->span_count = 0;
+    json_buf->span_capacity = 0;
+
+    return json_buf;
+}
+
+//包装调用者提供的缓冲区，json_buf本身通常位于栈上
+SIMJSON_PRIVATE inline void json_buf_init_fixed(JsonBuf *json_buf, char *buf, size_t size) {
+    json_buf->buf = buf;
+    json_buf->size = size;
+    json_buf->length = 0;
+    json_buf->sink = NULL;
+    json_buf->sink_ctx = NULL;
+    json_buf->fixed = true;
+    json_buf->segments = NULL;
+    json_buf->segment_count = 0;
+    json_buf->segment_capacity = 0;
+    json_buf->segment_start = 0;
+    json_buf->spans = NULL;
+    json_buf->span_count = 0;
+    json_buf->span_capacity = 0;
+}
+
+SIMJSON_PRIVATE inline void json_buf_free(JsonBuf *json_buf) {
+    free(json_buf->segments);
+    free(json_buf->spans);
+    free(json_buf->buf);
+    free(json_buf);
+}
+
+//释放json_buf_init_fixed之后附带分配的数据，buf仍归调用者
+SIMJSON_PRIVATE inline void json_buf_free_fixed(JsonBuf *json_buf) {
+    free(json_buf->spans);
+}
+
+SIMJSON_PRIVATE inline bool json_buf_grow(JsonBuf *json_buf, size_t needed) {
+    size_t new_size = json_buf->size * GROW_FACTOR;
+    if (new_size < json_buf->length + needed) {
+        new_size = json_buf->length + needed;
+    }
+
+    char *new_buf = realloc(json_buf->buf, new_size);
+    if (new_buf == NULL) {
+        DEBUG_INFO(strerror(errno));
+        return false;
+    }
+    else {
+        json_buf->buf = new_buf;
+        json_buf->size = new_size;
+        return true;
+    }
+}
+
+SIMJSON_PRIVATE inline bool json_buf_has_space_for(JsonBuf *json_buf, size_t needed) {
+    return json_buf->length + needed <= json_buf->size;
+}
+
+//将缓冲区内容交给sink输出，未设置sink时不做任何事
+SIMJSON_PRIVATE inline bool json_buf_flush(JsonBuf *json_buf) {
+    if (json_buf->sink == NULL || json_buf->length == 0) {
+        return true;
+    }
+    if (!json_buf->sink(json_buf->sink_ctx, json_buf->buf, json_buf->length)) {
+        DEBUG_INFO("sink failed");
+        return false;
+    }
+    json_buf->length = 0;
+    return true;
+}
+
+SIMJSON_PRIVATE inline bool json_buf_append(JsonBuf *json_buf, const char *str, size_t length) {
+    if (length == 0) {
+        return true;
+    }
+    if (!json_buf_has_space_for(json_buf, length)) {
+        if (json_buf->fixed) {
+            json_buf->length += length;
+            return true;
+        }
+        else if (json_buf->sink == NULL) {
+            if (!json_buf_grow(json_buf, length)) {
+                return false;
+            }
+        }
+        else {
+            if (!json_buf_flush(json_buf)) {
+                return false;
+            }
+            //超过缓冲区大小的数据直接交给sink
+            if (length > json_buf->size) {
+                return json_buf->sink(json_buf->sink_ctx, str, length);
+            }
+        }
+    }
+    memcpy(json_buf->buf + json_buf->length, str, length);
+    json_buf->length += length;
+    return true;
+}
+
+//进入聚集写模式
+SIMJSON_PRIVATE inline bool json_buf_enable_segments(JsonBuf *json_buf, size_t initial_capacity) {
+    json_buf->segments = malloc(initial_capacity * sizeof(JsonSegment));
+    if (json_buf->segments == NULL) {
+        DEBUG_INFO(strerror(errno));
+        return false;
+    }
+    json_buf->segment_capacity = initial_capacity;
+    return true;
+}
+
+SIMJSON_PRIVATE inline bool json_buf_push_segment(JsonBuf *json_buf, const char *data, size_t offset, size_t length) {
+    if (json_buf->segment_count == json_buf->segment_capacity) {
+        size_t new_capacity = json_buf->segment_capacity * GROW_FACTOR;
+        JsonSegment *new_segments = realloc(json_buf->segments, new_capacity * sizeof(JsonSegment));
+        if (new_segments == NULL) {
+            DEBUG_INFO(strerror(errno));
+            return false;
+        }
+        json_buf->segments = new_segments;
+        json_buf->segment_capacity = new_capacity;
+    }
+    json_buf->segments[json_buf->segment_count++] = (JsonSegment) {data, offset, length};
+    return true;
+}
+
+SIMJSON_PRIVATE inline bool json_buf_push_span(JsonBuf *json_buf, const void *owner, size_t offset, size_t length) {
+    if (json_buf->span_count == json_buf->span_capacity) {
+        size_t new_capacity = json_buf->span_capacity == 0 ? 16 : json_buf->span_capacity * GROW_FACTOR;
+        JsonSpan *new_spans = realloc(json_buf->spans, new_capacity * sizeof(JsonSpan));
+        if (new_spans == NULL) {
+            DEBUG_INFO(strerror(errno));
+            return false;
+        }
+        json_buf->spans = new_spans;
+        json_buf->span_capacity = new_capacity;
+    }
+    json_buf->spans[json_buf->span_count++] = (JsonSpan) {owner, offset, length};
+    return true;
+}
+
+//把buf中尚未记录的数据记为一段，连续的标点与短值因此合并在同一段
+SIMJSON_PRIVATE inline bool json_buf_close_segment(JsonBuf *json_buf) {
+    if (json_buf->length == json_buf->segment_start) {
+        return true;
+    }
+    if (!json_buf_push_segment(json_buf, NULL, json_buf->segment_start, json_buf->length - json_buf->segment_start)) {
+        return false;
+    }
+    json_buf->segment_start = json_buf->length;
+    return true;
+}
+
+//聚集写模式下只引用str，调用者保证str在输出完成前有效；否则与json_buf_append相同
+SIMJSON_PRIVATE inline bool json_buf_append_reference(JsonBuf *json_buf, const char *str, size_t length) {
+    if (json_buf->segments == NULL) {
+        return json_buf_append(json_buf, str, length);
+    }
+    return json_buf_close_segment(json_buf) && json_buf_push_segment(json_buf, str, 0, length);
+}
+
+SIMJSON_PRIVATE inline bool need_escape(char c) {
+    return c == '\"' || c == '\\' || (uint8_t) c < 0x20;
+}
+
+//返回第一个需要转义的字符的下标，不存在时返回length
+//整块跳过无需转义的字节：SSE2每次16字节，否则每次8字节(SWAR)
+SIMJSON_PRIVATE inline size_t json_find_escape(const char *str, size_t length) {
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128i quote = _mm_set1_epi8('\"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control_max = _mm_set1_epi8(0x1F);
+    for (; i + 16 <= length; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *) (str + i));
+        //无符号比较c <= 0x1F等价于max(c, 0x1F) == 0x1F
+        __m128i special = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(block, quote), _mm_cmpeq_epi8(block, backslash)),
+                _mm_cmpeq_epi8(_mm_max_epu8(block, control_max), control_max));
+        int mask = _mm_movemask_epi8(special);
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+#else
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint64_t highs = 0x8080808080808080ULL;
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word;
+        memcpy(&word, str + i, 8);
+        uint64_t quote = word ^ (ones * '\"');
+        uint64_t backslash = word ^ (ones * '\\');
+        //某字节为0或小于0x20时对应的最高位被置1，可能有误报，由逐字节检查确认
+        uint64_t special = ((quote - ones) & ~quote) | ((backslash - ones) & ~backslash) |
+                           ((word - ones * 0x20) & ~word);
+        if (special & highs) {
+            break;
+        }
+    }
+#endif
+
+    for (; i < length; i++) {
+        if (need_escape(str[i])) {
+            return i;
+        }
+    }
+    return length;
+}
+
+//把需要转义的字符c写成转义序列，返回序列长度
+SIMJSON_PRIVATE inline size_t json_escape_char(char c, char *escaped) {
+    const static char HEX[] = "0123456789abcdef";
+    escaped[0] = '\\';
+    escaped[1] = c;
+    switch (c) {
+        case '\"':
+        case '\\':
+            return 2;
+        case '\b':
+            escaped[1] = 'b';
+            return 2;
+        case '\f':
+            escaped[1] = 'f';
+            return 2;
+        case '\n':
+            escaped[1] = 'n';
+            return 2;
+        case '\r':
+            escaped[1] = 'r';
+            return 2;
+        case '\t':
+            escaped[1] = 't';
+            return 2;
+        default:
+            escaped[1] = 'u';
+            escaped[2] = '0';
+            escaped[3] = '0';
+            escaped[4] = HEX[(uint8_t) c >> 4];
+            escaped[5] = HEX[(uint8_t) c & 0xF];
+            return 6;
+    }
+}
+
+//按json规则转义后追加，连续的无需转义的字符整段追加
+SIMJSON_PRIVATE inline bool json_buf_append_escaped(JsonBuf *json_buf, const char *str, size_t length) {
+    size_t i = 0;
+
+    while (true) {
+        size_t run = json_find_escape(str + i, length - i);
+        if (!json_buf_append(json_buf, str + i, run)) {
+            return false;
+        }
+        i += run;
+        if (i == length) {
+            return true;
+        }
+
+        char escaped[6];
+        size_t escaped_length = json_escape_char(str[i++], escaped);
+        if (!json_buf_append(json_buf, escaped, escaped_length)) {
+            return false;
+        }
+    }
+}
+
+//与json_buf_append_escaped相同，但直接写入dst，调用者保证dst有json_escaped_length的空间，返回写入后的位置
+SIMJSON_PRIVATE inline char *json_write_escaped(char *dst, const char *str, size_t length) {
+    size_t i = 0;
+
+    while (true) {
+        size_t run = json_find_escape(str + i, length - i);
+        memcpy(dst, str + i, run);
+        dst += run;
+        i += run;
+        if (i == length) {
+            return dst;
+        }
+        dst += json_escape_char(str[i++], dst);
+    }
+}
+
+//以下函数计算对应json_buf_append_*写入的精确长度
+SIMJSON_PRIVATE inline size_t json_escaped_length(const char *str, size_t length) {
+    size_t escaped_length = length;
+    size_t i = json_find_escape(str, length);
+    while (i < length) {
+        char c = str[i];
+        if (c == '\"' || c == '\\' || c == '\b' || c == '\f' || c == '\n' || c == '\r' || c == '\t') {
+            escaped_length += 1;
+        }
+        else {
+            escaped_length += 5;
+        }
+        i++;
+        i += json_find_escape(str + i, length - i);
+    }
+    return escaped_length;
+}
+
+SIMJSON_PRIVATE inline size_t json_integer_length(int64_t value) {
+    size_t length = 1;
+    uint64_t abs_value = (uint64_t) value;
+    if (value < 0) {
+        length++;
+        abs_value = 0 - abs_value;
+    }
+    while (abs_value >= 10) {
+        abs_value /= 10;
+        length++;
+    }
+    return length;
+}
+
+SIMJSON_PRIVATE inline size_t json_double_length(double value) {
+    char buf[NUMBER_BUF_SIZE];
+    return snprintf(buf, sizeof(buf), "%g", value);
+}
+
+//与json_integer_length的位数一致，从低位向高位写入dst，返回写入后的位置
+SIMJSON_PRIVATE inline char *json_write_integer(char *dst, int64_t value) {
+    size_t length = json_integer_length(value);
+    uint64_t abs_value = (uint64_t) value;
+    if (value < 0) {
+        dst[0] = '-';
+        abs_value = 0 - abs_value;
+    }
+
+    char *cur = dst + length;
+    do {
+        *--cur = (char) ('0' + abs_value % 10);
+        abs_value /= 10;
+    } while (abs_value != 0);
+    return dst + length;
+}
+
+SIMJSON_PRIVATE inline bool json_buf_append_integer(JsonBuf *json_buf, int64_t value) {
+    char buf[NUMBER_BUF_SIZE];
+    return json_buf_append(json_buf, buf, json_write_integer(buf, value) - buf);
+}
+
+SIMJSON_PRIVATE inline bool json_buf_append_double(JsonBuf *json_buf, double value) {
+    char buf[NUMBER_BUF_SIZE];
+    //todo 精度
+    int length = snprintf(buf, sizeof(buf), "%g", value);
+    return json_buf_append(json_buf, buf, length);
+}
+
+//交出内部缓冲区并释放json_buf，返回以'\0'结尾的字符串，无需再拷贝
+SIMJSON_PRIVATE inline char *json_buf_release(JsonBuf *json_buf, size_t *length) {
+    if (!json_buf_has_space_for(json_buf, 1) && !json_buf_grow(json_buf, 1)) {
+        json_buf_free(json_buf);
+        return NULL;
+    }
+    char *buf = json_buf->buf;
+    buf[json_buf->length] = '\0';
+    if (length != NULL) {
+        *length = json_buf->length;
+    }
+    free(json_buf->segments);
+    free(json_buf->spans);
+    free(json_buf);
+    return buf;
+}
+
+#endif //SIMJSON_JSON_BUF_H
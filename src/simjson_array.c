@@ -68,6 +68,7 @@ SIMJSON_PUBLIC SimjsonArray *simjson_array_new() {
     array->tail->prev = array->head;
     array->size = 0;
     array->type = SIMJSON_ARRAY_TYPE;
+    array->cache = (SimjsonEncodeCache) {NULL, NULL, 0, NULL, 0, 0, 0, false};
 
     return array;
 }
@@ -85,6 +86,7 @@ SIMJSON_PUBLIC void simjson_array_free(SimjsonArray *array) {
         simjson_array_item_free(cur_item);
         cur_item = next_item;
     }
+    simjson_encode_cache_release(&array->cache);
     free(array);
 }
 
@@ -126,6 +128,7 @@ SIMJSON_PUBLIC bool simjson_array_insert(SimjsonArray *array, void *json_struct,
     cur_item->next = item;
 
     array->size++;
+    simjson_encode_cache_attach(array, json_struct);
 
     return true;
 }
@@ -180,25 +183,26 @@ SIMJSON_PUBLIC bool simjson_array_delete(SimjsonArray *array, size_t index) {
     cur_item->next->prev = cur_item->prev;
     simjson_array_item_free(cur_item);
     array->size--;
+    simjson_encode_cache_invalidate(array);
 
     return true;
 }
 
-SIMJSON_PUBLIC SimjsonArrayIterator *simjson_array_iterator_new(SimjsonArray *array, size_t start_index) {
+SIMJSON_PUBLIC bool simjson_array_iterator_init(SimjsonArrayIterator *iterator, SimjsonArray *array,
+                                                size_t start_index) {
+    if (iterator == NULL) {
+        DEBUG_INFO("iterator is NULL");
+        return false;
+    }
+
     if (array == NULL) {
         DEBUG_INFO("array is NULL");
-        return NULL;
+        return false;
     }
 
     if (start_index < 0 || (start_index >= array->size)) {
         DEBUG_INFO("start_index out of range");
-        return NULL;
-    }
-
-    SimjsonArrayIterator *iterator = malloc(sizeof(SimjsonArrayIterator));
-    if (iterator == NULL) {
-        DEBUG_INFO(strerror(errno));
-        return NULL;
+        return false;
     }
 
     iterator->cur_item = array->head->next;
@@ -209,6 +213,21 @@ SIMJSON_PUBLIC SimjsonArrayIterator *simjson_array_iterator_new(SimjsonArray *ar
         iterator->cur_index++;
     }
 
+    return true;
+}
+
+SIMJSON_PUBLIC SimjsonArrayIterator *simjson_array_iterator_new(SimjsonArray *array, size_t start_index) {
+    SimjsonArrayIterator *iterator = malloc(sizeof(SimjsonArrayIterator));
+    if (iterator == NULL) {
+        DEBUG_INFO(strerror(errno));
+        return NULL;
+    }
+
+    if (!simjson_array_iterator_init(iterator, array, start_index)) {
+        free(iterator);
+        return NULL;
+    }
+
     return iterator;
 }
 
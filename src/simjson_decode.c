@@ -13,7 +13,31 @@
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
  */
 
-const static uint8_t INVALID_CHAR = 32;
+//字符分类，驱动值的分派与空白跳过
+enum {
+    CHAR_CLASS_INVALID = 0,
+    CHAR_CLASS_WS,
+    CHAR_CLASS_STRING,
+    CHAR_CLASS_NUMBER,
+    CHAR_CLASS_BOOLEAN,
+    CHAR_CLASS_NULL,
+    CHAR_CLASS_ARRAY,
+    CHAR_CLASS_OBJECT,
+    CHAR_CLASS_COUNT
+};
+
+const static uint8_t CHAR_CLASS[256] = {
+        [' '] = CHAR_CLASS_WS, ['\t'] = CHAR_CLASS_WS, ['\n'] = CHAR_CLASS_WS, ['\r'] = CHAR_CLASS_WS,
+        ['\"'] = CHAR_CLASS_STRING,
+        ['-'] = CHAR_CLASS_NUMBER,
+        ['0'] = CHAR_CLASS_NUMBER, ['1'] = CHAR_CLASS_NUMBER, ['2'] = CHAR_CLASS_NUMBER, ['3'] = CHAR_CLASS_NUMBER,
+        ['4'] = CHAR_CLASS_NUMBER, ['5'] = CHAR_CLASS_NUMBER, ['6'] = CHAR_CLASS_NUMBER, ['7'] = CHAR_CLASS_NUMBER,
+        ['8'] = CHAR_CLASS_NUMBER, ['9'] = CHAR_CLASS_NUMBER,
+        ['t'] = CHAR_CLASS_BOOLEAN, ['f'] = CHAR_CLASS_BOOLEAN,
+        ['n'] = CHAR_CLASS_NULL,
+        ['['] = CHAR_CLASS_ARRAY,
+        ['{'] = CHAR_CLASS_OBJECT,
+};
 
 /*
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
@@ -23,6 +47,11 @@ typedef struct {
     const char *json_str;
     size_t length;
     size_t offset;
+    //原地解码时指向可修改的输入，否则为NULL
+    char *insitu_str;
+    //拷贝解码时用于反转义object键的临时缓冲区
+    char *scratch;
+    size_t scratch_size;
 } JsonBuf;
 
 /*
@@ -39,14 +68,31 @@ SIMJSON_PRIVATE JsonBuf *json_buf_new(const char *json_str, size_t length) {
     json_buf->json_str = json_str;
     json_buf->length = length;
     json_buf->offset = 0;
+    json_buf->insitu_str = NULL;
+    json_buf->scratch = NULL;
+    json_buf->scratch_size = 0;
 
     return json_buf;
 }
 
 SIMJSON_PRIVATE void json_buf_free(JsonBuf *json_buf) {
+    free(json_buf->scratch);
     free(json_buf);
 }
 
+SIMJSON_PRIVATE char *json_buf_scratch(JsonBuf *json_buf, size_t needed) {
+    if (json_buf->scratch_size < needed) {
+        char *scratch = realloc(json_buf->scratch, needed);
+        if (scratch == NULL) {
+            DEBUG_INFO(strerror(errno));
+            return NULL;
+        }
+        json_buf->scratch = scratch;
+        json_buf->scratch_size = needed;
+    }
+    return json_buf->scratch;
+}
+
 SIMJSON_PRIVATE inline char json_buf_cur_char(JsonBuf *json_buf) {
     return (json_buf->json_str + json_buf->offset)[0];
 }
@@ -59,89 +105,219 @@ SIMJSON_PRIVATE inline bool json_buf_reach_end(JsonBuf *json_buf) {
     return json_buf->offset >= json_buf->length;
 }
 
-SIMJSON_PRIVATE inline bool is_string(char c) {
-    return c == '\"';
-}
-
-SIMJSON_PRIVATE inline bool is_number(char c) {
-    return c == '-' || (c >= '0' && c <= '9');
+SIMJSON_PRIVATE inline size_t json_buf_remaining(JsonBuf *json_buf) {
+    return json_buf->length - json_buf->offset;
 }
 
-SIMJSON_PRIVATE inline bool is_boolean(char c) {
-    return c == 't' || c == 'f';
+SIMJSON_PRIVATE inline uint8_t char_class(char c) {
+    return CHAR_CLASS[(uint8_t) c];
 }
 
-SIMJSON_PRIVATE inline bool is_null(char c) {
-    return c == 'n';
+//以单次32位读取比较4字节字面量，调用者需保证剩余长度足够
+SIMJSON_PRIVATE inline bool match_word(const char *str, const char *literal) {
+    uint32_t word;
+    uint32_t expected;
+    memcpy(&word, str, 4);
+    memcpy(&expected, literal, 4);
+    return word == expected;
 }
 
-SIMJSON_PRIVATE inline bool is_array(char c) {
-    return c == '[';
-}
-
-SIMJSON_PRIVATE inline bool is_object(char c) {
-    return c == '{';
+SIMJSON_PRIVATE inline bool is_string(char c) {
+    return char_class(c) == CHAR_CLASS_STRING;
 }
 
 SIMJSON_PRIVATE inline void skip_ws(JsonBuf *json_buf) {
-    while (!json_buf_reach_end(json_buf) && json_buf_cur_char(json_buf) <= INVALID_CHAR) {
+    while (!json_buf_reach_end(json_buf) && char_class(json_buf_cur_char(json_buf)) == CHAR_CLASS_WS) {
         json_buf->offset++;
     }
 }
 
 SIMJSON_PRIVATE inline bool reach_array_end(JsonBuf *json_buf) {
-    return json_buf_cur_char(json_buf) == ']';
+    return !json_buf_reach_end(json_buf) && json_buf_cur_char(json_buf) == ']';
 }
 
 SIMJSON_PRIVATE inline bool reach_object_end(JsonBuf *json_buf) {
-    return json_buf_cur_char(json_buf) == '}';
+    return !json_buf_reach_end(json_buf) && json_buf_cur_char(json_buf) == '}';
 }
 
-SIMJSON_PRIVATE bool get_string_length(JsonBuf *json_buf, size_t *length) {
-    size_t len = 0;
+SIMJSON_PRIVATE inline int hex_value(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    else if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    else if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
 
-    while (!json_buf_reach_end(json_buf)) {
-        if (json_buf_cur_char(json_buf) == '\\') {
-            json_buf->offset++;
-            char c = json_buf_cur_char(json_buf);
-            //todo 处理unicode相关(\u)
-            if (c == '\"' || c == '\\' || c == '/' || c == 'b' || c == 'n' || c == 'r' || c == 't') {
-                json_buf->offset++;
-                len += 2;
+SIMJSON_PRIVATE inline bool is_hex4(const char *str) {
+    return hex_value(str[0]) >= 0 && hex_value(str[1]) >= 0 && hex_value(str[2]) >= 0 && hex_value(str[3]) >= 0;
+}
+
+SIMJSON_PRIVATE inline uint32_t read_hex4(const char *str) {
+    return (uint32_t) (hex_value(str[0]) << 12 | hex_value(str[1]) << 8 | hex_value(str[2]) << 4 | hex_value(str[3]));
+}
+
+SIMJSON_PRIVATE size_t encode_utf8(uint32_t code, char *out) {
+    if (code < 0x80) {
+        out[0] = (char) code;
+        return 1;
+    }
+    else if (code < 0x800) {
+        out[0] = (char) (0xC0 | (code >> 6));
+        out[1] = (char) (0x80 | (code & 0x3F));
+        return 2;
+    }
+    else if (code < 0x10000) {
+        out[0] = (char) (0xE0 | (code >> 12));
+        out[1] = (char) (0x80 | ((code >> 6) & 0x3F));
+        out[2] = (char) (0x80 | (code & 0x3F));
+        return 3;
+    }
+    else {
+        out[0] = (char) (0xF0 | (code >> 18));
+        out[1] = (char) (0x80 | ((code >> 12) & 0x3F));
+        out[2] = (char) (0x80 | ((code >> 6) & 0x3F));
+        out[3] = (char) (0x80 | (code & 0x3F));
+        return 4;
+    }
+}
+
+//扫描字符串直到结束引号并校验转义序列，offset保持在字符串起始处不变
+//length为未反转义的原始长度，has_escape表示字符串是否包含转义序列
+SIMJSON_PRIVATE bool scan_string(JsonBuf *json_buf, size_t *length, bool *has_escape) {
+    const char *str = json_buf_cur_str(json_buf);
+    size_t remaining = json_buf_remaining(json_buf);
+    bool escaped = false;
+    size_t i = 0;
+
+    while (i < remaining) {
+        if (str[i] == '\"') {
+            assert(length != NULL && has_escape != NULL);
+            *length = i;
+            *has_escape = escaped;
+            return true;
+        }
+        else if (str[i] == '\\') {
+            if (i + 1 >= remaining) {
+                return false;
+            }
+            escaped = true;
+            char c = str[i + 1];
+            if (c == '\"' || c == '\\' || c == '/' || c == 'b' || c == 'f' || c == 'n' || c == 'r' || c == 't') {
+                i += 2;
+            }
+            else if (c == 'u' && i + 6 <= remaining && is_hex4(str + i + 2)) {
+                i += 6;
             }
             else {
                 return false;
             }
         }
-        else if (json_buf_cur_char(json_buf) == '\"') {
-            assert(length != NULL);
-            json_buf->offset -= len;
-            *length = len;
-            return true;
-        }
         else {
-            json_buf->offset++;
-            len++;
+            i++;
         }
     }
 
     return false;
 }
 
+//反转义经scan_string校验过的字符串，返回写入dst的长度
+//输出不会长于输入，因此dst可以与src相同(原地反转义)
+SIMJSON_PRIVATE size_t unescape_string(const char *src, size_t length, char *dst) {
+    const char *end = src + length;
+    char *out = dst;
+
+    while (src < end) {
+        const char *backslash = memchr(src, '\\', end - src);
+        size_t run = (backslash == NULL ? end : backslash) - src;
+        if (out != src) {
+            memmove(out, src, run);
+        }
+        out += run;
+        src += run;
+        if (src == end) {
+            break;
+        }
+
+        char c = src[1];
+        src += 2;
+        switch (c) {
+            case 'b':
+                *out++ = '\b';
+                break;
+            case 'f':
+                *out++ = '\f';
+                break;
+            case 'n':
+                *out++ = '\n';
+                break;
+            case 'r':
+                *out++ = '\r';
+                break;
+            case 't':
+                *out++ = '\t';
+                break;
+            case 'u': {
+                uint32_t code = read_hex4(src);
+                src += 4;
+                //代理对合并为一个码点，孤立的代理项按原值编码
+                if (code >= 0xD800 && code <= 0xDBFF && end - src >= 6 && src[0] == '\\' && src[1] == 'u') {
+                    uint32_t low = read_hex4(src + 2);
+                    if (low >= 0xDC00 && low <= 0xDFFF) {
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                        src += 6;
+                    }
+                }
+                out += encode_utf8(code, out);
+                break;
+            }
+            default:
+                *out++ = c;
+                break;
+        }
+    }
+
+    return out - dst;
+}
+
 SIMJSON_PRIVATE bool decode_object_key(JsonBuf *json_buf, const char **key_start, size_t *key_length) {
     skip_ws(json_buf);
 
-    if (!is_string(json_buf_cur_char(json_buf))) {
+    if (json_buf_reach_end(json_buf) || !is_string(json_buf_cur_char(json_buf))) {
         return false;
     }
 
     json_buf->offset++;
-    if (!get_string_length(json_buf, key_length)) {
+    size_t length;
+    bool has_escape;
+    if (!scan_string(json_buf, &length, &has_escape)) {
         return false;
     }
 
-    *key_start = json_buf_cur_str(json_buf);
-    json_buf->offset += *key_length + 1;
+    if (json_buf->insitu_str != NULL) {
+        char *key = json_buf->insitu_str + json_buf->offset;
+        *key_length = has_escape ? unescape_string(key, length, key) : length;
+        key[*key_length] = '\0';
+        *key_start = key;
+    }
+    else if (has_escape) {
+        char *scratch = json_buf_scratch(json_buf, length);
+        if (scratch == NULL) {
+            return false;
+        }
+        *key_length = unescape_string(json_buf_cur_str(json_buf), length, scratch);
+        *key_start = scratch;
+    }
+    else {
+        *key_length = length;
+        *key_start = json_buf_cur_str(json_buf);
+    }
+
+    json_buf->offset += length + 1;
     return true;
 }
 
@@ -198,12 +374,27 @@ SIMJSON_PRIVATE void *decode_string(JsonBuf *json_buf) {
     json_buf->offset++;
 
     size_t length;
-    if (!get_string_length(json_buf, &length)) {
+    bool has_escape;
+    if (!scan_string(json_buf, &length, &has_escape)) {
         DEBUG_INFO("string type syntax error");
         return NULL;
     }
 
-    SimjsonString *string = simjson_string_new(json_buf_cur_str(json_buf), length);
+    SimjsonString *string;
+    if (json_buf->insitu_str != NULL) {
+        //结束引号处写入'\0'，反转义后的值不会超过原始长度
+        char *value = json_buf->insitu_str + json_buf->offset;
+        size_t value_length = has_escape ? unescape_string(value, length, value) : length;
+        value[value_length] = '\0';
+        string = simjson_string_new_borrowed(value, value_length);
+    }
+    else {
+        string = simjson_string_new(json_buf_cur_str(json_buf), length);
+        if (string != NULL && has_escape) {
+            string->length = unescape_string(string->value, length, string->value);
+            string->value[string->length] = '\0';
+        }
+    }
     if (string == NULL) {
         return NULL;
     }
@@ -240,7 +431,10 @@ SIMJSON_PRIVATE void *decode_number(JsonBuf *json_buf) {
 }
 
 SIMJSON_PRIVATE void *decode_boolean(JsonBuf *json_buf) {
-    if (strncmp(json_buf_cur_str(json_buf), "true", 4) == 0) {
+    const char *str = json_buf_cur_str(json_buf);
+    size_t remaining = json_buf_remaining(json_buf);
+
+    if (remaining >= 4 && match_word(str, "true")) {
         SimjsonBoolean *boolean = simjson_boolean_new(true);
         if (boolean == NULL) {
             return NULL;
@@ -248,7 +442,7 @@ SIMJSON_PRIVATE void *decode_boolean(JsonBuf *json_buf) {
         json_buf->offset += 4;
         return boolean;
     }
-    else if (strncmp(json_buf_cur_str(json_buf), "false", 5) == 0) {
+    else if (remaining >= 5 && match_word(str + 1, "alse") && str[0] == 'f') {
         SimjsonBoolean *boolean = simjson_boolean_new(false);
         if (boolean == NULL) {
             return NULL;
@@ -263,7 +457,7 @@ SIMJSON_PRIVATE void *decode_boolean(JsonBuf *json_buf) {
 }
 
 SIMJSON_PRIVATE void *decode_null(JsonBuf *json_buf) {
-    if (strncmp(json_buf_cur_str(json_buf), "null", 4) == 0) {
+    if (json_buf_remaining(json_buf) >= 4 && match_word(json_buf_cur_str(json_buf), "null")) {
         SimjsonNull *null = simjson_null_new();
         if (null == NULL) {
             return NULL;
@@ -301,7 +495,7 @@ SIMJSON_PRIVATE void *decode_array(JsonBuf *json_buf) {
         if (reach_array_end(json_buf)) {
             goto SUCCESS;
         }
-        else if (json_buf_cur_char(json_buf) == ',') {
+        else if (!json_buf_reach_end(json_buf) && json_buf_cur_char(json_buf) == ',') {
             json_buf->offset++;
         }
         else {
@@ -340,7 +534,7 @@ SIMJSON_PRIVATE void *decode_object(JsonBuf *json_buf) {
 
         skip_ws(json_buf);
 
-        if (json_buf_cur_char(json_buf) != ':') {
+        if (json_buf_reach_end(json_buf) || json_buf_cur_char(json_buf) != ':') {
             goto FAILED;
         }
         json_buf->offset++;
@@ -349,14 +543,19 @@ SIMJSON_PRIVATE void *decode_object(JsonBuf *json_buf) {
         if (value == NULL) {
             goto FAILED;
         }
-        simjson_object_add(object, key_start, key_length, value);
+        if (json_buf->insitu_str != NULL) {
+            simjson_object_add_borrowed(object, key_start, key_length, value);
+        }
+        else {
+            simjson_object_add(object, key_start, key_length, value);
+        }
 
         skip_ws(json_buf);
 
         if (reach_object_end(json_buf)) {
             goto SUCCESS;
         }
-        else if (json_buf_cur_char(json_buf) == ',') {
+        else if (!json_buf_reach_end(json_buf) && json_buf_cur_char(json_buf) == ',') {
             json_buf->offset++;
         }
         else {
@@ -374,33 +573,366 @@ SIMJSON_PRIVATE void *decode_object(JsonBuf *json_buf) {
     return object;
 }
 
+SIMJSON_PRIVATE void *decode_invalid(JsonBuf *json_buf) {
+    (void) json_buf;
+    DEBUG_INFO("Unknown json type");
+    return NULL;
+}
+
+//按首字符的分类查表分派，空白已在decode中跳过，故映射为decode_invalid
+SIMJSON_PRIVATE void *(*const DECODERS[CHAR_CLASS_COUNT])(JsonBuf *) = {
+        [CHAR_CLASS_INVALID] = decode_invalid,
+        [CHAR_CLASS_WS] = decode_invalid,
+        [CHAR_CLASS_STRING] = decode_string,
+        [CHAR_CLASS_NUMBER] = decode_number,
+        [CHAR_CLASS_BOOLEAN] = decode_boolean,
+        [CHAR_CLASS_NULL] = decode_null,
+        [CHAR_CLASS_ARRAY] = decode_array,
+        [CHAR_CLASS_OBJECT] = decode_object,
+};
+
 SIMJSON_PRIVATE void *decode(JsonBuf *json_buf) {
     skip_ws(json_buf);
     if (json_buf_reach_end(json_buf)) {
         return NULL;
     }
 
-    if (is_string(json_buf_cur_char(json_buf))) {
-        return decode_string(json_buf);
+    return DECODERS[char_class(json_buf_cur_char(json_buf))](json_buf);
+}
+
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ */
+
+//跳过一个值而不创建json对象，用于schema中不存在的键
+SIMJSON_PRIVATE bool skip_value(JsonBuf *json_buf) {
+    skip_ws(json_buf);
+    if (json_buf_reach_end(json_buf)) {
+        return false;
+    }
+
+    size_t length;
+    bool has_escape;
+    double double_value;
+    const char *str = json_buf_cur_str(json_buf);
+    size_t remaining = json_buf_remaining(json_buf);
+
+    switch (char_class(json_buf_cur_char(json_buf))) {
+        case CHAR_CLASS_STRING:
+            json_buf->offset++;
+            if (!scan_string(json_buf, &length, &has_escape)) {
+                return false;
+            }
+            json_buf->offset += length + 1;
+            return true;
+        case CHAR_CLASS_NUMBER:
+            if (!get_double(json_buf, &double_value, &length)) {
+                return false;
+            }
+            json_buf->offset += length;
+            return true;
+        case CHAR_CLASS_BOOLEAN:
+            if (remaining >= 4 && match_word(str, "true")) {
+                json_buf->offset += 4;
+                return true;
+            }
+            else if (remaining >= 5 && match_word(str + 1, "alse") && str[0] == 'f') {
+                json_buf->offset += 5;
+                return true;
+            }
+            return false;
+        case CHAR_CLASS_NULL:
+            if (remaining >= 4 && match_word(str, "null")) {
+                json_buf->offset += 4;
+                return true;
+            }
+            return false;
+        case CHAR_CLASS_ARRAY:
+            json_buf->offset++;
+            skip_ws(json_buf);
+            if (reach_array_end(json_buf)) {
+                json_buf->offset++;
+                return true;
+            }
+            while (skip_value(json_buf)) {
+                skip_ws(json_buf);
+                if (reach_array_end(json_buf)) {
+                    json_buf->offset++;
+                    return true;
+                }
+                else if (json_buf_reach_end(json_buf) || json_buf_cur_char(json_buf) != ',') {
+                    return false;
+                }
+                json_buf->offset++;
+            }
+            return false;
+        case CHAR_CLASS_OBJECT:
+            json_buf->offset++;
+            skip_ws(json_buf);
+            if (reach_object_end(json_buf)) {
+                json_buf->offset++;
+                return true;
+            }
+            while (skip_value(json_buf)) {
+                skip_ws(json_buf);
+                if (json_buf_reach_end(json_buf) || json_buf_cur_char(json_buf) != ':') {
+                    return false;
+                }
+                json_buf->offset++;
+                if (!skip_value(json_buf)) {
+                    return false;
+                }
+                skip_ws(json_buf);
+                if (reach_object_end(json_buf)) {
+                    json_buf->offset++;
+                    return true;
+                }
+                else if (json_buf_reach_end(json_buf) || json_buf_cur_char(json_buf) != ',') {
+                    return false;
+                }
+                json_buf->offset++;
+            }
+            return false;
+        default:
+            return false;
+    }
+}
+
+SIMJSON_PRIVATE bool decode_struct(JsonBuf *json_buf, const SimjsonSchema *schema, void *struct_ptr);
+
+SIMJSON_PRIVATE bool decode_array_into(JsonBuf *json_buf, const SimjsonField *field, void *struct_ptr);
+
+//按字段类型将当前值写入dst，json为null时保持dst为零值
+SIMJSON_PRIVATE bool decode_value_into(JsonBuf *json_buf, uint8_t type, size_t size, const SimjsonSchema *schema,
+                                       void *dst) {
+    skip_ws(json_buf);
+    if (json_buf_reach_end(json_buf)) {
+        return false;
+    }
+
+    uint8_t cur_class = char_class(json_buf_cur_char(json_buf));
+    if (cur_class == CHAR_CLASS_NULL) {
+        return skip_value(json_buf);
+    }
+
+    size_t length;
+    bool has_escape;
+    int64_t integer_value;
+    double double_value;
+
+    switch (type) {
+        case SIMJSON_FIELD_INT64:
+        case SIMJSON_FIELD_INT32:
+            if (cur_class != CHAR_CLASS_NUMBER || !get_integer(json_buf, &integer_value, &length)) {
+                return false;
+            }
+            if (type == SIMJSON_FIELD_INT64) {
+                *(int64_t *) dst = integer_value;
+            }
+            else if (integer_value >= INT32_MIN && integer_value <= INT32_MAX) {
+                *(int32_t *) dst = (int32_t) integer_value;
+            }
+            else {
+                return false;
+            }
+            json_buf->offset += length;
+            return true;
+        case SIMJSON_FIELD_DOUBLE:
+            if (cur_class != CHAR_CLASS_NUMBER || !get_double(json_buf, &double_value, &length)) {
+                return false;
+            }
+            *(double *) dst = double_value;
+            json_buf->offset += length;
+            return true;
+        case SIMJSON_FIELD_BOOLEAN:
+            if (cur_class != CHAR_CLASS_BOOLEAN) {
+                return false;
+            }
+            *(bool *) dst = json_buf_cur_char(json_buf) == 't';
+            return skip_value(json_buf);
+        case SIMJSON_FIELD_STRING:
+        case SIMJSON_FIELD_CHARS: {
+            if (cur_class != CHAR_CLASS_STRING) {
+                return false;
+            }
+            json_buf->offset++;
+            if (!scan_string(json_buf, &length, &has_escape)) {
+                return false;
+            }
+
+            char *value;
+            if (type == SIMJSON_FIELD_STRING) {
+                value = malloc(length + 1);
+                if (value == NULL) {
+                    DEBUG_INFO(strerror(errno));
+                    return false;
+                }
+                *(char **) dst = value;
+            }
+            else if (has_escape) {
+                value = json_buf_scratch(json_buf, length);
+                if (value == NULL) {
+                    return false;
+                }
+            }
+            else {
+                value = (char *) json_buf_cur_str(json_buf);
+            }
+
+            size_t value_length = length;
+            if (has_escape) {
+                value_length = unescape_string(json_buf_cur_str(json_buf), length, value);
+            }
+            else if (type == SIMJSON_FIELD_STRING) {
+                memcpy(value, json_buf_cur_str(json_buf), length);
+            }
+
+            if (type == SIMJSON_FIELD_CHARS) {
+                if (value_length >= size) {
+                    DEBUG_INFO("string exceeds field capacity");
+                    return false;
+                }
+                memcpy(dst, value, value_length);
+                value = dst;
+            }
+            value[value_length] = '\0';
+
+            json_buf->offset += length + 1;
+            return true;
+        }
+        case SIMJSON_FIELD_OBJECT:
+            return cur_class == CHAR_CLASS_OBJECT && decode_struct(json_buf, schema, dst);
+        default:
+            DEBUG_INFO("unsupported field type");
+            return false;
+    }
+}
+
+SIMJSON_PRIVATE bool decode_array_into(JsonBuf *json_buf, const SimjsonField *field, void *struct_ptr) {
+    skip_ws(json_buf);
+    if (json_buf_reach_end(json_buf)) {
+        return false;
     }
-    else if (is_number(json_buf_cur_char(json_buf))) {
-        return decode_number(json_buf);
+    if (char_class(json_buf_cur_char(json_buf)) == CHAR_CLASS_NULL) {
+        return skip_value(json_buf);
     }
-    else if (is_boolean(json_buf_cur_char(json_buf))) {
-        return decode_boolean(json_buf);
+    if (char_class(json_buf_cur_char(json_buf)) != CHAR_CLASS_ARRAY) {
+        return false;
+    }
+
+    size_t element_size = simjson_schema_element_size(field->element_type, field->schema);
+    if (element_size == 0) {
+        DEBUG_INFO("unsupported array element type");
+        return false;
+    }
+
+    //元素写入后立即更新数量，失败时由simjson_schema_free统一释放
+    char **elements = (char **) ((char *) struct_ptr + field->offset);
+    size_t *count = (size_t *) ((char *) struct_ptr + field->count_offset);
+    size_t capacity = 0;
+
+    json_buf->offset++;
+    skip_ws(json_buf);
+    if (reach_array_end(json_buf)) {
+        json_buf->offset++;
+        return true;
     }
-    else if (is_null(json_buf_cur_char(json_buf))) {
-        return decode_null(json_buf);
+
+    while (true) {
+        if (*count == capacity) {
+            capacity = capacity == 0 ? 4 : capacity * 2;
+            char *new_elements = realloc(*elements, capacity * element_size);
+            if (new_elements == NULL) {
+                DEBUG_INFO(strerror(errno));
+                return false;
+            }
+            *elements = new_elements;
+        }
+
+        char *element = *elements + *count * element_size;
+        memset(element, 0, element_size);
+        (*count)++;
+        if (!decode_value_into(json_buf, field->element_type, 0, field->schema, element)) {
+            return false;
+        }
+
+        skip_ws(json_buf);
+        if (reach_array_end(json_buf)) {
+            json_buf->offset++;
+            return true;
+        }
+        else if (json_buf_reach_end(json_buf) || json_buf_cur_char(json_buf) != ',') {
+            return false;
+        }
+        json_buf->offset++;
     }
-    else if (is_array(json_buf_cur_char(json_buf))) {
-        return decode_array(json_buf);
+}
+
+//按键查找字段，键通常与schema声明顺序一致，故从上一个匹配字段之后开始查找
+SIMJSON_PRIVATE const SimjsonField *find_field(const SimjsonSchema *schema, const char *key, size_t key_length,
+                                               size_t *hint) {
+    for (size_t i = 0; i < schema->field_count; i++) {
+        size_t index = (*hint + i) % schema->field_count;
+        const SimjsonField *field = &schema->fields[index];
+        if (field->name_length == key_length && memcmp(field->name, key, key_length) == 0) {
+            *hint = index + 1;
+            return field;
+        }
     }
-    else if (is_object(json_buf_cur_char(json_buf))) {
-        return decode_object(json_buf);
+    return NULL;
+}
+
+SIMJSON_PRIVATE bool decode_struct(JsonBuf *json_buf, const SimjsonSchema *schema, void *struct_ptr) {
+    json_buf->offset++;
+    skip_ws(json_buf);
+    if (reach_object_end(json_buf)) {
+        json_buf->offset++;
+        return true;
     }
-    else {
-        DEBUG_INFO("Unknown json type");
-        return NULL;
+
+    size_t hint = 0;
+    while (true) {
+        const char *key_start;
+        size_t key_length;
+        if (!decode_object_key(json_buf, &key_start, &key_length)) {
+            return false;
+        }
+
+        skip_ws(json_buf);
+        if (json_buf_reach_end(json_buf) || json_buf_cur_char(json_buf) != ':') {
+            return false;
+        }
+        json_buf->offset++;
+
+        const SimjsonField *field = schema->field_count == 0 ? NULL : find_field(schema, key_start, key_length, &hint);
+        bool success;
+        if (field == NULL) {
+            success = skip_value(json_buf);
+        }
+        else {
+            //重复的键以最后一次为准，先释放上一次写入的字符串、数组与内嵌结构体
+            simjson_schema_field_reset(field, struct_ptr);
+            if (field->type == SIMJSON_FIELD_ARRAY) {
+                success = decode_array_into(json_buf, field, struct_ptr);
+            }
+            else {
+                success = decode_value_into(json_buf, field->type, field->size, field->schema,
+                                            (char *) struct_ptr + field->offset);
+            }
+        }
+        if (!success) {
+            return false;
+        }
+
+        skip_ws(json_buf);
+        if (reach_object_end(json_buf)) {
+            json_buf->offset++;
+            return true;
+        }
+        else if (json_buf_reach_end(json_buf) || json_buf_cur_char(json_buf) != ',') {
+            return false;
+        }
+        json_buf->offset++;
     }
 }
 
@@ -408,6 +940,17 @@ SIMJSON_PRIVATE void *decode(JsonBuf *json_buf) {
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
  */
 
+SIMJSON_PRIVATE void *decode_document(JsonBuf *json_buf) {
+    void *json_struct = decode(json_buf);
+
+    skip_ws(json_buf);
+    if (json_struct == NULL || !json_buf_reach_end(json_buf)) {
+        simjson_free_json_struct(json_struct);
+        return NULL;
+    }
+    return json_struct;
+}
+
 SIMJSON_PUBLIC void *simjson_decode(const char *json_str, size_t length) {
     if (json_str == NULL) {
         DEBUG_INFO("json_str is NULL");
@@ -419,16 +962,53 @@ SIMJSON_PUBLIC void *simjson_decode(const char *json_str, size_t length) {
         return NULL;
     }
 
-    void *json_struct = decode(json_buf);
+    void *json_struct = decode_document(json_buf);
+    json_buf_free(json_buf);
+    return json_struct;
+}
 
-    skip_ws(json_buf);
-    if (json_struct == NULL || !json_buf_reach_end(json_buf)) {
-        json_buf_free(json_buf);
-        simjson_free_json_struct(json_struct);
+SIMJSON_PUBLIC void *simjson_decode_insitu(char *json_str, size_t length) {
+    if (json_str == NULL) {
+        DEBUG_INFO("json_str is NULL");
         return NULL;
     }
-    else {
+
+    JsonBuf *json_buf = json_buf_new(json_str, length);
+    if (json_buf == NULL) {
+        return NULL;
+    }
+    json_buf->insitu_str = json_str;
+
+    void *json_struct = decode_document(json_buf);
+    json_buf_free(json_buf);
+    return json_struct;
+}
+
+SIMJSON_PUBLIC bool simjson_decode_into(const SimjsonSchema *schema, void *struct_ptr, const char *json_str,
+                                        size_t length) {
+    if (schema == NULL || struct_ptr == NULL || json_str == NULL) {
+        DEBUG_INFO("schema, struct_ptr or json_str is NULL");
+        return false;
+    }
+
+    JsonBuf *json_buf = json_buf_new(json_str, length);
+    if (json_buf == NULL) {
+        return false;
+    }
+
+    memset(struct_ptr, 0, schema->struct_size);
+
+    skip_ws(json_buf);
+    bool success = !json_buf_reach_end(json_buf) && char_class(json_buf_cur_char(json_buf)) == CHAR_CLASS_OBJECT &&
+                   decode_struct(json_buf, schema, struct_ptr);
+    skip_ws(json_buf);
+    if (!success || !json_buf_reach_end(json_buf)) {
+        DEBUG_INFO("decode into struct failed");
+        simjson_schema_free(schema, struct_ptr);
         json_buf_free(json_buf);
-        return json_struct;
+        return false;
     }
+
+    json_buf_free(json_buf);
+    return true;
 }
@@ -2,8 +2,14 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <stdio.h>
+#include <inttypes.h>
+#include <assert.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/uio.h>
 
 #include "simjson.h"
+#include "json_buf.h"
 #include "log.h"
 
 /*
@@ -11,94 +17,118 @@
  */
 
 const static size_t BUF_INITIAL_SIZE = 32;
-const static uint8_t GROW_FACTOR = 2;
+//流式编码时固定的输出缓冲区大小
+const static size_t SINK_BUF_SIZE = 64 * 1024;
+//并行编码时每个线程至少分到的元素数量，元素过少时线程开销超过收益
+const static size_t PARALLEL_MIN_ITEMS_PER_THREAD = 256;
+//聚集写时不小于该长度且无需转义的字符串直接引用，更短的拷贝比多一个iovec更划算
+const static size_t GATHER_MIN_STRING_LENGTH = 128;
+const static size_t GATHER_BUF_SIZE = 4 * 1024;
+//不超过该长度的子容器输出直接拷贝进父容器的缓存，更长的只引用
+//每个字节最多重复保存在CACHE_INLINE_LENGTH / 2层祖先中，复用时也不必逐个访问小容器
+const static size_t CACHE_INLINE_LENGTH = 128;
+const static size_t GATHER_SEGMENT_CAPACITY = 64;
+//每次writev提交的iovec数量，不超过IOV_MAX
+#define GATHER_WRITE_BATCH 256
 
 /*
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
  */
 
+//由SimjsonEncodeOptions解析得到的输出格式，编码过程中只查表不再判断模式
 typedef struct {
-    char *buf;
-    size_t size;
+    const char *item_separator;
+    size_t item_separator_length;
+    const char *key_separator;
+    size_t key_separator_length;
+    bool sort_keys;
+    //每层缩进的空格数，0表示不换行
+    uint8_t indent;
+    //与容器编码缓存匹配的格式标记，0表示输出依赖层级，不使用缓存
+    uint8_t cache_tag;
+} EncodeFormat;
+
+//object按键排序或分段并行编码时使用的键值对
+typedef struct {
+    char *key;
+    size_t key_length;
+    const char *key_fragment;
+    size_t key_fragment_length;
+    void *json_struct;
+} ObjectEntry;
+
+struct SimjsonGather {
+    //生成的标点与短值，以及各段的记录
+    JsonBuf *json_buf;
+    struct iovec *iov;
+    size_t iov_count;
     size_t length;
-} JsonBuf;
+};
+
+const static EncodeFormat DEFAULT_FORMAT = {", ", 2, ": ", 2, false, 0, 1};
+const static EncodeFormat COMPACT_FORMAT = {",", 1, ":", 1, false, 0, 2};
+const static EncodeFormat CANONICAL_FORMAT = {",", 1, ":", 1, true, 0, 3};
 
 /*
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
  */
 
-SIMJSON_PRIVATE JsonBuf *json_buf_new() {
-    JsonBuf *json_buf = malloc(sizeof(JsonBuf));
-    if (json_buf == NULL) {
-        DEBUG_INFO(strerror(errno));
-        return NULL;
-    }
-
-    json_buf->buf = malloc(BUF_INITIAL_SIZE);
-    if (json_buf->buf == NULL) {
-        DEBUG_INFO(strerror(errno));
-        free(json_buf);
-        return NULL;
-    }
-
-    json_buf->size = BUF_INITIAL_SIZE;
-    json_buf->length = 0;
-
-    return json_buf;
-}
-
-SIMJSON_PRIVATE void json_buf_free(JsonBuf *json_buf) {
-    free(json_buf->buf);
-    free(json_buf);
-}
+SIMJSON_PRIVATE bool encode(JsonBuf *json_buf, const EncodeFormat *format, size_t depth, void *json_struct);
 
-SIMJSON_PRIVATE bool json_buf_grow(JsonBuf *json_buf, size_t needed) {
-    char *new_buf = realloc(json_buf->buf, (json_buf->size + needed) * GROW_FACTOR);
-    if (new_buf == NULL) {
-        DEBUG_INFO(strerror(errno));
+SIMJSON_PRIVATE inline bool json_buf_append_indent(JsonBuf *json_buf, size_t spaces) {
+    const static char SPACES[] = "                                                                ";
+    if (!json_buf_append(json_buf, "\n", 1)) {
         return false;
     }
-    else {
-        json_buf->buf = new_buf;
-        json_buf->size = (json_buf->size + needed) * 2;
-        return true;
+    while (spaces > 0) {
+        size_t length = spaces < sizeof(SPACES) - 1 ? spaces : sizeof(SPACES) - 1;
+        if (!json_buf_append(json_buf, SPACES, length)) {
+            return false;
+        }
+        spaces -= length;
     }
+    return true;
 }
 
-SIMJSON_PRIVATE inline bool json_buf_has_space_for(JsonBuf *json_buf, size_t needed) {
-    return json_buf->length + needed <= json_buf->size;
+//容器内第index个元素之前的分隔符与缩进，depth为元素所在层级
+SIMJSON_PRIVATE inline bool encode_item_prefix(JsonBuf *json_buf, const EncodeFormat *format, size_t depth,
+                                               size_t index) {
+    if (index > 0 && !json_buf_append(json_buf, format->item_separator, format->item_separator_length)) {
+        return false;
+    }
+    return format->indent == 0 || json_buf_append_indent(json_buf, format->indent * depth);
 }
 
-SIMJSON_PRIVATE bool json_buf_append(JsonBuf *json_buf, const char *str, size_t length) {
-    if (!json_buf_has_space_for(json_buf, length) && !json_buf_grow(json_buf, length)) {
+SIMJSON_PRIVATE inline bool encode_close(JsonBuf *json_buf, const EncodeFormat *format, size_t depth,
+                                         const char *bracket) {
+    if (format->indent != 0 && !json_buf_append_indent(json_buf, format->indent * depth)) {
         return false;
     }
-    memcpy(json_buf->buf + json_buf->length, str, length);
-    json_buf->length += length;
-    return true;
+    return json_buf_append(json_buf, bracket, 1);
 }
 
-SIMJSON_PRIVATE char *json_buf_to_string(JsonBuf *json_buf) {
-    char *buf = malloc(json_buf->length + 1);
-    if (buf == NULL) {
-        DEBUG_INFO(strerror(errno));
-        return NULL;
+SIMJSON_PRIVATE int compare_object_entry(const void *a, const void *b) {
+    const ObjectEntry *entry_a = (const ObjectEntry *) a;
+    const ObjectEntry *entry_b = (const ObjectEntry *) b;
+    size_t length = entry_a->key_length < entry_b->key_length ? entry_a->key_length : entry_b->key_length;
+    int result = memcmp(entry_a->key, entry_b->key, length);
+    if (result != 0) {
+        return result;
     }
-    memcpy(buf, json_buf->buf, json_buf->length);
-    buf[json_buf->length] = '\0';
-    return buf;
+    return entry_a->key_length < entry_b->key_length ? -1 : entry_a->key_length > entry_b->key_length;
 }
 
-/*
- * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
- */
-
-SIMJSON_PRIVATE bool encode(JsonBuf *json_buf, void *json_struct);
-
 SIMJSON_PRIVATE bool encode_string(JsonBuf *json_buf, void *json_struct) {
     SimjsonString *string = (SimjsonString *) json_struct;
+    if (json_buf->segments != NULL && string->length >= GATHER_MIN_STRING_LENGTH &&
+        json_find_escape(string->value, string->length) == string->length) {
+        return json_buf_append(json_buf, "\"", 1) &&
+               json_buf_append_reference(json_buf, string->value, string->length) &&
+               json_buf_append(json_buf, "\"", 1);
+    }
+
     if (!json_buf_append(json_buf, "\"", 1) ||
-        !json_buf_append(json_buf, string->value, string->length) ||
+        !json_buf_append_escaped(json_buf, string->value, string->length) ||
         !json_buf_append(json_buf, "\"", 1)) {
         return false;
     }
@@ -107,31 +137,13 @@ SIMJSON_PRIVATE bool encode_string(JsonBuf *json_buf, void *json_struct) {
 
 SIMJSON_PRIVATE bool encode_number(JsonBuf *json_buf, void *json_struct) {
     SimjsonNumber *number = (SimjsonNumber *) json_struct;
-    size_t length;
-
-    if (number->is_integer) {
-        length = snprintf(NULL, 0, "%ld", number->value.integer_value);
-    }
-    else {
-        //todo 精度
-        length = snprintf(NULL, 0, "%g", number->value.double_value);
-    }
-
-    char *buf = malloc(length + 1);
-    if (buf == NULL) {
-        DEBUG_INFO(strerror(errno));
-        return false;
-    }
 
     if (number->is_integer) {
-        snprintf(buf, length + 1, "%ld", number->value.integer_value);
+        return json_buf_append_integer(json_buf, number->value.integer_value);
     }
     else {
-        //todo 精度
-        snprintf(buf, length + 1, "%g", number->value.double_value);
+        return json_buf_append_double(json_buf, number->value.double_value);
     }
-
-    return json_buf_append(json_buf, buf, length);
 }
 
 SIMJSON_PRIVATE bool encode_boolean(JsonBuf *json_buf, void *json_struct) {
@@ -148,7 +160,7 @@ SIMJSON_PRIVATE bool encode_null(JsonBuf *json_buf, void *json_struct) {
     return json_buf_append(json_buf, "null", 4);
 }
 
-SIMJSON_PRIVATE bool encode_array(JsonBuf *json_buf, void *json_struct) {
+SIMJSON_PRIVATE bool encode_array(JsonBuf *json_buf, const EncodeFormat *format, size_t depth, void *json_struct) {
     if (!json_buf_append(json_buf, "[", 1)) {
         return false;
     }
@@ -158,80 +170,231 @@ SIMJSON_PRIVATE bool encode_array(JsonBuf *json_buf, void *json_struct) {
         return json_buf_append(json_buf, "]", 1);
     }
 
-    SimjsonArrayIterator *iterator = simjson_array_iterator_new(array, 0);
-    if (iterator == NULL) {
+    SimjsonArrayIterator iterator;
+    if (!simjson_array_iterator_init(&iterator, array, 0)) {
         return false;
     }
 
     size_t index;
-    while (simjson_array_iterator_has_next(iterator)) {
-        void *iter_json_struct = simjson_array_iterator_next(iterator, &index);
-        if (!encode(json_buf, iter_json_struct)) {
-            goto FAILED;
-        }
-        if (index < array->size - 1) {
-            if (!json_buf_append(json_buf, ", ", 2)) {
-                goto FAILED;
-            }
+    while (simjson_array_iterator_has_next(&iterator)) {
+        void *iter_json_struct = simjson_array_iterator_next(&iterator, &index);
+        if (!encode_item_prefix(json_buf, format, depth + 1, index) ||
+            !encode(json_buf, format, depth + 1, iter_json_struct)) {
+            return false;
         }
     }
 
-    if (!json_buf_append(json_buf, "]", 1)) {
-        goto FAILED;
-    };
+    return encode_close(json_buf, format, depth, "]");
+}
 
-    return true;
+//键片段以"\"key\": "结尾，所有格式的键分隔符都是": "的前缀，截去多余的空格即可
+SIMJSON_PRIVATE inline size_t key_fragment_length_for(const EncodeFormat *format, size_t key_fragment_length) {
+    return key_fragment_length - 2 + format->key_separator_length;
+}
 
-    FAILED:
-    simjson_array_iterator_free(iterator);
-    return false;
+SIMJSON_PRIVATE bool encode_object_member(JsonBuf *json_buf, const EncodeFormat *format, size_t depth, size_t index,
+                                          const char *key_fragment, size_t key_fragment_length, void *json_struct) {
+    return encode_item_prefix(json_buf, format, depth + 1, index) &&
+           json_buf_append(json_buf, key_fragment, key_fragment_length_for(format, key_fragment_length)) &&
+           encode(json_buf, format, depth + 1, json_struct);
+}
+
+//按输出顺序收集object的键值对，sort_keys时按键的字节序排序
+//调用者负责free返回的数组
+SIMJSON_PRIVATE ObjectEntry *object_entries(SimjsonObject *object, bool sort_keys) {
+    ObjectEntry *entries = malloc(object->item_size * sizeof(ObjectEntry));
+    if (entries == NULL) {
+        DEBUG_INFO(strerror(errno));
+        return NULL;
+    }
+
+    SimjsonObjectIterator iterator;
+    if (!simjson_object_iterator_init(&iterator, object)) {
+        free(entries);
+        return NULL;
+    }
+    size_t count = 0;
+    while (simjson_object_iterator_has_next(&iterator)) {
+        ObjectEntry *entry = &entries[count++];
+        entry->json_struct = simjson_object_iterator_next(&iterator, &entry->key, &entry->key_length);
+        entry->key_fragment = simjson_object_iterator_key_fragment(&iterator, &entry->key_fragment_length);
+    }
+
+    if (sort_keys) {
+        qsort(entries, count, sizeof(ObjectEntry), compare_object_entry);
+    }
+    return entries;
 }
 
-SIMJSON_PRIVATE bool encode_object(JsonBuf *json_buf, void *json_struct) {
+//按键的字节序输出，用于规范化输出
+SIMJSON_PRIVATE bool encode_object_sorted(JsonBuf *json_buf, const EncodeFormat *format, size_t depth,
+                                          SimjsonObject *object) {
+    ObjectEntry *entries = object_entries(object, true);
+    if (entries == NULL) {
+        return false;
+    }
+
+    bool success = true;
+    for (size_t i = 0; success && i < object->item_size; i++) {
+        success = encode_object_member(json_buf, format, depth, i, entries[i].key_fragment,
+                                       entries[i].key_fragment_length, entries[i].json_struct);
+    }
+
+    free(entries);
+    return success;
+}
+
+SIMJSON_PRIVATE bool encode_object(JsonBuf *json_buf, const EncodeFormat *format, size_t depth, void *json_struct) {
     if (!json_buf_append(json_buf, "{", 1)) {
         return false;
     }
 
     SimjsonObject *object = (SimjsonObject *) json_struct;
-    SimjsonObjectIterator *iterator = simjson_object_iterator_new(object);
-    if (iterator == NULL) {
+    if (object->item_size == 0) {
+        return json_buf_append(json_buf, "}", 1);
+    }
+
+    if (format->sort_keys) {
+        return encode_object_sorted(json_buf, format, depth, object) && encode_close(json_buf, format, depth, "}");
+    }
+
+    SimjsonObjectIterator iterator;
+    if (!simjson_object_iterator_init(&iterator, object)) {
         return false;
     }
 
-    char *key;
-    size_t key_length;
-    size_t item_size = object->item_size;
-
-    while (simjson_object_iterator_has_next(iterator)) {
-        void *iter_json_struct = simjson_object_iterator_next(iterator, &key, &key_length);
-        if (!json_buf_append(json_buf, "\"", 1) ||
-            !json_buf_append(json_buf, key, key_length) ||
-            !json_buf_append(json_buf, "\"", 1) ||
-            !json_buf_append(json_buf, ": ", 2)) {
-            goto FAILED;
-        }
-        if (!encode(json_buf, iter_json_struct)) {
-            goto FAILED;
-        }
-        if (--item_size) {
-            if (!json_buf_append(json_buf, ", ", 2)) {
-                goto FAILED;
-            }
+    const char *key_fragment;
+    size_t key_fragment_length;
+    size_t index = 0;
+
+    while (simjson_object_iterator_has_next(&iterator)) {
+        void *iter_json_struct = simjson_object_iterator_next(&iterator, NULL, NULL);
+        key_fragment = simjson_object_iterator_key_fragment(&iterator, &key_fragment_length);
+        if (!encode_object_member(json_buf, format, depth, index++, key_fragment, key_fragment_length,
+                                  iter_json_struct)) {
+            return false;
         }
     }
 
-    if (!json_buf_append(json_buf, "}", 1)) {
-        goto FAILED;
+    return encode_close(json_buf, format, depth, "}");
+}
+
+SIMJSON_PRIVATE inline bool cache_valid_for(const SimjsonEncodeCache *cache, const EncodeFormat *format) {
+    return cache != NULL && cache->enabled && cache->encoded != NULL && format->cache_tag != 0 &&
+           cache->format == format->cache_tag;
+}
+
+//依次输出自身的字节与引用的子容器缓存
+SIMJSON_PRIVATE bool cache_emit(JsonBuf *json_buf, const SimjsonEncodeCache *cache) {
+    size_t offset = 0;
+    for (size_t i = 0; i < cache->ref_count; i++) {
+        const SimjsonEncodeCacheRef *ref = &cache->refs[i];
+        if (!json_buf_append(json_buf, cache->encoded + offset, ref->offset - offset) ||
+            !cache_emit(json_buf, simjson_encode_cache_of(ref->child))) {
+            return false;
+        }
+        offset = ref->offset;
+    }
+    return json_buf_append(json_buf, cache->encoded + offset, cache->own_length - offset);
+}
+
+//把buf[start, json_buf->length)保存为缓存，spans[mark, span_count)是其中已缓存的子树，较长的只记录引用
+SIMJSON_PRIVATE bool cache_save(SimjsonEncodeCache *cache, const JsonBuf *json_buf, const EncodeFormat *format,
+                                size_t start, size_t mark) {
+    size_t ref_count = 0;
+    size_t own_length = json_buf->length - start;
+    for (size_t i = mark; i < json_buf->span_count; i++) {
+        if (json_buf->spans[i].owner == NULL) {
+            return false;
+        }
+        if (json_buf->spans[i].length > CACHE_INLINE_LENGTH) {
+            ref_count++;
+            own_length -= json_buf->spans[i].length;
+        }
+    }
+
+    char *encoded = malloc(own_length);
+    SimjsonEncodeCacheRef *refs = NULL;
+    if (encoded == NULL || (ref_count != 0 && (refs = malloc(ref_count * sizeof(SimjsonEncodeCacheRef))) == NULL)) {
+        free(encoded);
+        return false;
+    }
+
+    size_t position = start;
+    size_t offset = 0;
+    size_t ref_index = 0;
+    for (size_t i = mark; i < json_buf->span_count; i++) {
+        const JsonSpan *span = &json_buf->spans[i];
+        if (span->length <= CACHE_INLINE_LENGTH) {
+            continue;
+        }
+        memcpy(encoded + offset, json_buf->buf + position, span->offset - position);
+        offset += span->offset - position;
+        position = span->offset + span->length;
+        refs[ref_index++] = (SimjsonEncodeCacheRef) {offset, (void *) span->owner};
     }
+    memcpy(encoded + offset, json_buf->buf + position, json_buf->length - position);
 
+    //旧缓存是其它格式的，引用它的祖先也要失效
+    if (cache->encoded != NULL) {
+        simjson_encode_cache_invalidate(cache->parent);
+        simjson_encode_cache_release(cache);
+    }
+    cache->encoded = encoded;
+    cache->own_length = own_length;
+    cache->refs = refs;
+    cache->ref_count = ref_count;
+    cache->encoded_length = json_buf->length - start;
+    cache->format = format->cache_tag;
     return true;
+}
 
-    FAILED:
-    simjson_object_iterator_free(iterator);
-    return false;
+//只有完整保存在buf中的输出才能缓存，sink与聚集写模式只复用不保存
+SIMJSON_PRIVATE inline bool cache_saving(const JsonBuf *json_buf, const EncodeFormat *format) {
+    return format->cache_tag != 0 && json_buf->sink == NULL && json_buf->segments == NULL;
+}
+
+//容器的输出buf[start, length)写完后调用，spans[mark, span_count)是其中已缓存的子树
+//保存缓存并把整个容器记为一段，外层容器的缓存由此引用
+SIMJSON_PRIVATE bool cache_finish(JsonBuf *json_buf, const EncodeFormat *format, void *json_struct, size_t start,
+                                  size_t mark) {
+    SimjsonEncodeCache *cache = simjson_encode_cache_of(json_struct);
+    //未启用缓存的容器只需让启用缓存的父容器知道子树未缓存，其余情况交给更外层处理
+    if (!cache->enabled) {
+        SimjsonEncodeCache *parent_cache = simjson_encode_cache_of(cache->parent);
+        if (parent_cache == NULL || !parent_cache->enabled) {
+            return true;
+        }
+    }
+
+    //固定缓冲区放不下或缓存失败时不影响编码结果，只是外层容器也不再缓存
+    bool cached = cache->enabled && json_buf->length <= json_buf->size &&
+                  cache_save(cache, json_buf, format, start, mark);
+    json_buf->span_count = mark;
+    return json_buf_push_span(json_buf, cached ? json_struct : NULL, start, json_buf->length - start);
 }
 
-SIMJSON_PRIVATE bool encode(JsonBuf *json_buf, void *json_struct) {
+//启用缓存的容器优先复用缓存，否则编码后保存为缓存
+SIMJSON_PRIVATE bool encode_container(JsonBuf *json_buf, const EncodeFormat *format, size_t depth,
+                                      void *json_struct) {
+    SimjsonEncodeCache *cache = simjson_encode_cache_of(json_struct);
+    bool saving = cache_saving(json_buf, format);
+    size_t start = json_buf->length;
+    if (cache_valid_for(cache, format)) {
+        return cache_emit(json_buf, cache) &&
+               (!saving || json_buf_push_span(json_buf, json_struct, start, json_buf->length - start));
+    }
+
+    size_t mark = json_buf->span_count;
+    bool success = SIMJSON_IS_ARRAY_TYPE(json_struct) ? encode_array(json_buf, format, depth, json_struct)
+                                                      : encode_object(json_buf, format, depth, json_struct);
+    if (!success || !saving) {
+        return success;
+    }
+    return cache_finish(json_buf, format, json_struct, start, mark);
+}
+
+SIMJSON_PRIVATE bool encode(JsonBuf *json_buf, const EncodeFormat *format, size_t depth, void *json_struct) {
     if (SIMJSON_IS_STRING_TYPE(json_struct)) {
         return encode_string(json_buf, json_struct);
     }
@@ -244,11 +407,94 @@ SIMJSON_PRIVATE bool encode(JsonBuf *json_buf, void *json_struct) {
     else if (SIMJSON_IS_NULL_TYPE(json_struct)) {
         return encode_null(json_buf, json_struct);
     }
+    else if (SIMJSON_IS_ARRAY_TYPE(json_struct) || SIMJSON_IS_OBJECT_TYPE(json_struct)) {
+        return encode_container(json_buf, format, depth, json_struct);
+    }
+    else {
+        DEBUG_INFO("Unknown data type");
+        return false;
+    }
+}
+
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ */
+
+//非空容器中n个元素的分隔符、换行与缩进的总长度，depth为容器所在层级
+SIMJSON_PRIVATE inline size_t separators_size(const EncodeFormat *format, size_t depth, size_t n) {
+    size_t size = format->item_separator_length * (n - 1);
+    if (format->indent != 0) {
+        size += n * (1 + format->indent * (depth + 1)) + 1 + format->indent * depth;
+    }
+    return size;
+}
+
+//计算encode输出的精确长度，遍历方式与encode一致，排序不影响长度
+SIMJSON_PRIVATE bool encoded_size(const EncodeFormat *format, size_t depth, void *json_struct, size_t *size) {
+    if (SIMJSON_IS_STRING_TYPE(json_struct)) {
+        SimjsonString *string = (SimjsonString *) json_struct;
+        *size += 2 + json_escaped_length(string->value, string->length);
+        return true;
+    }
+    else if (SIMJSON_IS_NUMBER_TYPE(json_struct)) {
+        SimjsonNumber *number = (SimjsonNumber *) json_struct;
+        *size += number->is_integer ? json_integer_length(number->value.integer_value)
+                                    : json_double_length(number->value.double_value);
+        return true;
+    }
+    else if (SIMJSON_IS_BOOLEAN_TYPE(json_struct)) {
+        *size += ((SimjsonBoolean *) json_struct)->value ? 4 : 5;
+        return true;
+    }
+    else if (SIMJSON_IS_NULL_TYPE(json_struct)) {
+        *size += 4;
+        return true;
+    }
+    else if (cache_valid_for(simjson_encode_cache_of(json_struct), format)) {
+        *size += simjson_encode_cache_of(json_struct)->encoded_length;
+        return true;
+    }
     else if (SIMJSON_IS_ARRAY_TYPE(json_struct)) {
-        return encode_array(json_buf, json_struct);
+        SimjsonArray *array = (SimjsonArray *) json_struct;
+        *size += 2;
+        if (array->size == 0) {
+            return true;
+        }
+        *size += separators_size(format, depth, array->size);
+
+        SimjsonArrayIterator iterator;
+        if (!simjson_array_iterator_init(&iterator, array, 0)) {
+            return false;
+        }
+        while (simjson_array_iterator_has_next(&iterator)) {
+            if (!encoded_size(format, depth + 1, simjson_array_iterator_next(&iterator, NULL), size)) {
+                return false;
+            }
+        }
+        return true;
     }
     else if (SIMJSON_IS_OBJECT_TYPE(json_struct)) {
-        return encode_object(json_buf, json_struct);
+        SimjsonObject *object = (SimjsonObject *) json_struct;
+        *size += 2;
+        if (object->item_size == 0) {
+            return true;
+        }
+        *size += separators_size(format, depth, object->item_size);
+
+        SimjsonObjectIterator iterator;
+        if (!simjson_object_iterator_init(&iterator, object)) {
+            return false;
+        }
+        size_t key_fragment_length;
+        while (simjson_object_iterator_has_next(&iterator)) {
+            void *iter_json_struct = simjson_object_iterator_next(&iterator, NULL, NULL);
+            simjson_object_iterator_key_fragment(&iterator, &key_fragment_length);
+            *size += key_fragment_length_for(format, key_fragment_length);
+            if (!encoded_size(format, depth + 1, iter_json_struct, size)) {
+                return false;
+            }
+        }
+        return true;
     }
     else {
         DEBUG_INFO("Unknown data type");
@@ -256,6 +502,689 @@ SIMJSON_PRIVATE bool encode(JsonBuf *json_buf, void *json_struct) {
     }
 }
 
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ */
+
+SIMJSON_PRIVATE bool encode_struct(JsonBuf *json_buf, const EncodeFormat *format, size_t depth,
+                                   const SimjsonSchema *schema, const void *struct_ptr);
+
+SIMJSON_PRIVATE bool encode_value_from(JsonBuf *json_buf, const EncodeFormat *format, size_t depth, uint8_t type,
+                                       const SimjsonSchema *schema, const void *value) {
+    switch (type) {
+        case SIMJSON_FIELD_INT64:
+            return json_buf_append_integer(json_buf, *(const int64_t *) value);
+        case SIMJSON_FIELD_INT32:
+            return json_buf_append_integer(json_buf, *(const int32_t *) value);
+        case SIMJSON_FIELD_DOUBLE:
+            return json_buf_append_double(json_buf, *(const double *) value);
+        case SIMJSON_FIELD_BOOLEAN:
+            return *(const bool *) value ? json_buf_append(json_buf, "true", 4) : json_buf_append(json_buf, "false", 5);
+        case SIMJSON_FIELD_STRING: {
+            const char *str = *(char *const *) value;
+            if (str == NULL) {
+                return json_buf_append(json_buf, "null", 4);
+            }
+            return json_buf_append(json_buf, "\"", 1) &&
+                   json_buf_append_escaped(json_buf, str, strlen(str)) &&
+                   json_buf_append(json_buf, "\"", 1);
+        }
+        case SIMJSON_FIELD_CHARS:
+            return json_buf_append(json_buf, "\"", 1) &&
+                   json_buf_append_escaped(json_buf, value, strlen(value)) &&
+                   json_buf_append(json_buf, "\"", 1);
+        case SIMJSON_FIELD_OBJECT:
+            return encode_struct(json_buf, format, depth, schema, value);
+        default:
+            DEBUG_INFO("unsupported field type");
+            return false;
+    }
+}
+
+SIMJSON_PRIVATE bool encode_array_from(JsonBuf *json_buf, const EncodeFormat *format, size_t depth,
+                                       const SimjsonField *field, const void *struct_ptr) {
+    const char *elements = *(char *const *) ((const char *) struct_ptr + field->offset);
+    size_t count = *(const size_t *) ((const char *) struct_ptr + field->count_offset);
+    size_t element_size = simjson_schema_element_size(field->element_type, field->schema);
+    if (element_size == 0) {
+        DEBUG_INFO("unsupported array element type");
+        return false;
+    }
+
+    if (!json_buf_append(json_buf, "[", 1)) {
+        return false;
+    }
+    if (count == 0) {
+        return json_buf_append(json_buf, "]", 1);
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (!encode_item_prefix(json_buf, format, depth + 1, i) ||
+            !encode_value_from(json_buf, format, depth + 1, field->element_type, field->schema,
+                               elements + i * element_size)) {
+            return false;
+        }
+    }
+    return encode_close(json_buf, format, depth, "]");
+}
+
+SIMJSON_PRIVATE int compare_field_name(const void *a, const void *b) {
+    const SimjsonField *field_a = *(const SimjsonField *const *) a;
+    const SimjsonField *field_b = *(const SimjsonField *const *) b;
+    size_t length = field_a->name_length < field_b->name_length ? field_a->name_length : field_b->name_length;
+    int result = memcmp(field_a->name, field_b->name, length);
+    if (result != 0) {
+        return result;
+    }
+    return field_a->name_length < field_b->name_length ? -1 : field_a->name_length > field_b->name_length;
+}
+
+SIMJSON_PRIVATE bool encode_field(JsonBuf *json_buf, const EncodeFormat *format, size_t depth, size_t index,
+                                  const SimjsonField *field, const void *struct_ptr) {
+    if (!encode_item_prefix(json_buf, format, depth + 1, index)) {
+        return false;
+    }
+
+    //预转义的键片段与object的键片段一样以": "结尾
+    if (field->key_fragment != NULL) {
+        size_t key_fragment_length = key_fragment_length_for(format, field->key_fragment_length);
+        if (!json_buf_append(json_buf, field->key_fragment, key_fragment_length)) {
+            return false;
+        }
+    }
+    else if (!json_buf_append(json_buf, "\"", 1) ||
+             !json_buf_append_escaped(json_buf, field->name, field->name_length) ||
+             !json_buf_append(json_buf, "\"", 1) ||
+             !json_buf_append(json_buf, format->key_separator, format->key_separator_length)) {
+        return false;
+    }
+
+    if (field->type == SIMJSON_FIELD_ARRAY) {
+        return encode_array_from(json_buf, format, depth + 1, field, struct_ptr);
+    }
+    return encode_value_from(json_buf, format, depth + 1, field->type, field->schema,
+                             (const char *) struct_ptr + field->offset);
+}
+
+//字段按schema声明顺序输出，sort_keys时按字段名的字节序输出
+SIMJSON_PRIVATE bool encode_struct(JsonBuf *json_buf, const EncodeFormat *format, size_t depth,
+                                   const SimjsonSchema *schema, const void *struct_ptr) {
+    if (!json_buf_append(json_buf, "{", 1)) {
+        return false;
+    }
+    if (schema->field_count == 0) {
+        return json_buf_append(json_buf, "}", 1);
+    }
+
+    if (!format->sort_keys) {
+        for (size_t i = 0; i < schema->field_count; i++) {
+            if (!encode_field(json_buf, format, depth, i, &schema->fields[i], struct_ptr)) {
+                return false;
+            }
+        }
+        return encode_close(json_buf, format, depth, "}");
+    }
+
+    const SimjsonField **fields = malloc(schema->field_count * sizeof(SimjsonField *));
+    if (fields == NULL) {
+        DEBUG_INFO(strerror(errno));
+        return false;
+    }
+    for (size_t i = 0; i < schema->field_count; i++) {
+        fields[i] = &schema->fields[i];
+    }
+    qsort(fields, schema->field_count, sizeof(SimjsonField *), compare_field_name);
+
+    bool success = true;
+    for (size_t i = 0; success && i < schema->field_count; i++) {
+        success = encode_field(json_buf, format, depth, i, fields[i], struct_ptr);
+    }
+    free(fields);
+    return success && encode_close(json_buf, format, depth, "}");
+}
+
+SIMJSON_PRIVATE bool fd_sink(void *ctx, const char *data, size_t length) {
+    int fd = *(int *) ctx;
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            DEBUG_INFO(strerror(errno));
+            return false;
+        }
+        data += written;
+        length -= written;
+    }
+    return true;
+}
+
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ */
+
+//流式编码的双缓冲：json_buf写满的缓冲区交给后台线程输出，编码同时写入另一块缓冲区
+//同一时刻最多一块缓冲区在输出，sink的调用按输出顺序串行进行
+typedef struct {
+    SimjsonSink sink;
+    void *sink_ctx;
+    JsonBuf *json_buf;
+    //不在json_buf中的那块缓冲区，可能正在输出
+    char *spare;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    //交给后台线程的数据，输出完成后置为NULL
+    const char *pending;
+    size_t pending_length;
+    bool failed;
+    bool closing;
+} AsyncSink;
+
+SIMJSON_PRIVATE void *async_sink_run(void *arg) {
+    AsyncSink *async_sink = (AsyncSink *) arg;
+
+    pthread_mutex_lock(&async_sink->mutex);
+    while (true) {
+        while (async_sink->pending == NULL && !async_sink->closing) {
+            pthread_cond_wait(&async_sink->cond, &async_sink->mutex);
+        }
+        if (async_sink->pending == NULL) {
+            break;
+        }
+
+        const char *data = async_sink->pending;
+        size_t length = async_sink->pending_length;
+        pthread_mutex_unlock(&async_sink->mutex);
+        bool success = async_sink->sink(async_sink->sink_ctx, data, length);
+        pthread_mutex_lock(&async_sink->mutex);
+
+        if (!success) {
+            async_sink->failed = true;
+        }
+        async_sink->pending = NULL;
+        pthread_cond_broadcast(&async_sink->cond);
+    }
+    pthread_mutex_unlock(&async_sink->mutex);
+    return NULL;
+}
+
+//等待正在进行的输出完成，返回此前所有输出是否成功
+SIMJSON_PRIVATE bool async_sink_wait(AsyncSink *async_sink) {
+    pthread_mutex_lock(&async_sink->mutex);
+    while (async_sink->pending != NULL) {
+        pthread_cond_wait(&async_sink->cond, &async_sink->mutex);
+    }
+    bool success = !async_sink->failed;
+    pthread_mutex_unlock(&async_sink->mutex);
+    return success;
+}
+
+//作为json_buf的sink，写满的缓冲区与spare交换后交给后台线程，不拷贝数据
+SIMJSON_PRIVATE bool async_sink_write(void *ctx, const char *data, size_t length) {
+    AsyncSink *async_sink = (AsyncSink *) ctx;
+    if (!async_sink_wait(async_sink)) {
+        return false;
+    }
+
+    //超过缓冲区大小、直接交给sink的数据引用的是json对象的内存，等前一块输出完成后同步输出
+    JsonBuf *json_buf = async_sink->json_buf;
+    if (data != json_buf->buf) {
+        return async_sink->sink(async_sink->sink_ctx, data, length);
+    }
+
+    json_buf->buf = async_sink->spare;
+    async_sink->spare = (char *) data;
+
+    pthread_mutex_lock(&async_sink->mutex);
+    async_sink->pending = data;
+    async_sink->pending_length = length;
+    pthread_cond_signal(&async_sink->cond);
+    pthread_mutex_unlock(&async_sink->mutex);
+    return true;
+}
+
+//创建后台线程失败时返回false，调用者退回到同步输出
+SIMJSON_PRIVATE bool async_sink_start(AsyncSink *async_sink, JsonBuf *json_buf, SimjsonSink sink, void *sink_ctx) {
+    async_sink->spare = malloc(json_buf->size);
+    if (async_sink->spare == NULL) {
+        DEBUG_INFO(strerror(errno));
+        return false;
+    }
+    async_sink->sink = sink;
+    async_sink->sink_ctx = sink_ctx;
+    async_sink->json_buf = json_buf;
+    async_sink->pending = NULL;
+    async_sink->pending_length = 0;
+    async_sink->failed = false;
+    async_sink->closing = false;
+    pthread_mutex_init(&async_sink->mutex, NULL);
+    pthread_cond_init(&async_sink->cond, NULL);
+
+    if (pthread_create(&async_sink->thread, NULL, async_sink_run, async_sink) != 0) {
+        DEBUG_INFO("pthread_create failed");
+        pthread_cond_destroy(&async_sink->cond);
+        pthread_mutex_destroy(&async_sink->mutex);
+        free(async_sink->spare);
+        return false;
+    }
+
+    json_buf->sink = async_sink_write;
+    json_buf->sink_ctx = async_sink;
+    return true;
+}
+
+//等待最后一块输出完成并结束后台线程，返回所有输出是否成功
+SIMJSON_PRIVATE bool async_sink_stop(AsyncSink *async_sink) {
+    bool success = async_sink_wait(async_sink);
+
+    pthread_mutex_lock(&async_sink->mutex);
+    async_sink->closing = true;
+    pthread_cond_signal(&async_sink->cond);
+    pthread_mutex_unlock(&async_sink->mutex);
+    pthread_join(async_sink->thread, NULL);
+
+    pthread_cond_destroy(&async_sink->cond);
+    pthread_mutex_destroy(&async_sink->mutex);
+    free(async_sink->spare);
+    return success;
+}
+
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ */
+
+SIMJSON_PRIVATE bool resolve_format(const SimjsonEncodeOptions *options, EncodeFormat *format) {
+    if (options == NULL) {
+        *format = DEFAULT_FORMAT;
+        return true;
+    }
+
+    switch (options->mode) {
+        case SIMJSON_ENCODE_DEFAULT:
+            *format = DEFAULT_FORMAT;
+            return true;
+        case SIMJSON_ENCODE_COMPACT:
+            *format = COMPACT_FORMAT;
+            return true;
+        case SIMJSON_ENCODE_CANONICAL:
+            *format = CANONICAL_FORMAT;
+            return true;
+        case SIMJSON_ENCODE_PRETTY:
+            *format = (EncodeFormat) {",", 1, ": ", 2, false, options->indent == 0 ? 4 : options->indent, 0};
+            return true;
+        default:
+            DEBUG_INFO("unknown encode mode");
+            return false;
+    }
+}
+
+SIMJSON_PRIVATE char *encode_with_format(void *json_struct, const EncodeFormat *format, size_t *json_str_length) {
+    //预先计算精确长度，只分配一次，编码过程中不再扩容
+    size_t size = 0;
+    if (!encoded_size(format, 0, json_struct, &size)) {
+        return NULL;
+    }
+
+    char *json_str = malloc(size + 1);
+    if (json_str == NULL) {
+        DEBUG_INFO(strerror(errno));
+        return NULL;
+    }
+
+    //固定缓冲区写满后只累计长度而不越界，长度与预先计算的不一致时视为失败
+    JsonBuf json_buf;
+    json_buf_init_fixed(&json_buf, json_str, size);
+    bool success = encode(&json_buf, format, 0, json_struct) && json_buf.length == size;
+    json_buf_free_fixed(&json_buf);
+    if (!success) {
+        DEBUG_INFO("encode failed");
+        free(json_str);
+        return NULL;
+    }
+
+    json_str[size] = '\0';
+    if (json_str_length != NULL) {
+        *json_str_length = size;
+    }
+    return json_str;
+}
+
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ */
+
+//被拆分容器中的一段连续元素，由一个线程编码到自己的缓冲区
+typedef struct EncodeRange {
+    const EncodeFormat *format;
+    //被拆分容器所在的层级
+    size_t depth;
+    //容器是array时，从iterator处开始编码count个元素
+    SimjsonArrayIterator iterator;
+    //容器是object时，编码entries[start, start + count)
+    const ObjectEntry *entries;
+    size_t start;
+    size_t count;
+    JsonBuf *json_buf;
+    bool success;
+    //线程池队列中的下一段
+    struct EncodeRange *next;
+    //提交者尚未完成的段数，由线程池的mutex保护
+    size_t *pending;
+} EncodeRange;
+
+//元素的index与顺序编码时相同，输出的分隔符与缩进也就相同
+SIMJSON_PRIVATE void encode_range(EncodeRange *range) {
+    range->json_buf = json_buf_new(BUF_INITIAL_SIZE, NULL, NULL);
+    if (range->json_buf == NULL) {
+        return;
+    }
+
+    range->success = true;
+    for (size_t i = range->start; range->success && i < range->start + range->count; i++) {
+        if (range->entries != NULL) {
+            const ObjectEntry *entry = &range->entries[i];
+            range->success = encode_object_member(range->json_buf, range->format, range->depth, i,
+                                                  entry->key_fragment, entry->key_fragment_length,
+                                                  entry->json_struct);
+        }
+        else {
+            void *json_struct = simjson_array_iterator_next(&range->iterator, NULL);
+            range->success = encode_item_prefix(range->json_buf, range->format, range->depth + 1, i) &&
+                             encode(range->json_buf, range->format, range->depth + 1, json_struct);
+        }
+    }
+}
+
+//并行编码共用的常驻线程池，首次使用时按在线CPU数创建，线程一直存在到进程退出
+//提交者等待时也从队列中取段编码，线程创建失败时所有段由提交者自己完成
+typedef struct {
+    pthread_mutex_t mutex;
+    //队列中有新的段时唤醒工作线程
+    pthread_cond_t range_ready;
+    //有段完成时唤醒等待的提交者
+    pthread_cond_t range_done;
+    EncodeRange *head;
+    EncodeRange *tail;
+} EncodePool;
+
+static EncodePool encode_pool = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER,
+                                 NULL, NULL};
+static pthread_once_t encode_pool_once = PTHREAD_ONCE_INIT;
+
+//持有mutex时调用，编码期间释放mutex
+SIMJSON_PRIVATE void encode_pool_run_head(void) {
+    EncodeRange *range = encode_pool.head;
+    encode_pool.head = range->next;
+    if (encode_pool.head == NULL) {
+        encode_pool.tail = NULL;
+    }
+
+    pthread_mutex_unlock(&encode_pool.mutex);
+    encode_range(range);
+    pthread_mutex_lock(&encode_pool.mutex);
+
+    (*range->pending)--;
+    pthread_cond_broadcast(&encode_pool.range_done);
+}
+
+SIMJSON_PRIVATE void *encode_pool_worker(void *arg) {
+    (void) arg;
+    pthread_mutex_lock(&encode_pool.mutex);
+    while (true) {
+        while (encode_pool.head == NULL) {
+            pthread_cond_wait(&encode_pool.range_ready, &encode_pool.mutex);
+        }
+        encode_pool_run_head();
+    }
+    return NULL;
+}
+
+SIMJSON_PRIVATE void encode_pool_init(void) {
+    long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+    //提交者自己也参与编码，少创建一个线程
+    for (long i = 1; i < cpu_count; i++) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, encode_pool_worker, NULL) != 0) {
+            DEBUG_INFO("pthread_create failed");
+            break;
+        }
+        pthread_detach(thread);
+    }
+}
+
+//把count段交给线程池并等待全部完成
+SIMJSON_PRIVATE void encode_pool_submit(EncodeRange *ranges, size_t count) {
+    pthread_once(&encode_pool_once, encode_pool_init);
+
+    size_t pending = count;
+    pthread_mutex_lock(&encode_pool.mutex);
+    for (size_t i = 0; i < count; i++) {
+        ranges[i].pending = &pending;
+        ranges[i].next = NULL;
+        if (encode_pool.tail == NULL) {
+            encode_pool.head = &ranges[i];
+        }
+        else {
+            encode_pool.tail->next = &ranges[i];
+        }
+        encode_pool.tail = &ranges[i];
+    }
+    pthread_cond_broadcast(&encode_pool.range_ready);
+
+    while (pending > 0) {
+        if (encode_pool.head != NULL) {
+            encode_pool_run_head();
+        }
+        else {
+            pthread_cond_wait(&encode_pool.range_done, &encode_pool.mutex);
+        }
+    }
+    pthread_mutex_unlock(&encode_pool.mutex);
+}
+
+//容器只有一个元素且该元素也是容器时返回该元素，否则返回NULL
+SIMJSON_PRIVATE void *only_child_container(void *json_struct) {
+    void *child = NULL;
+    if (SIMJSON_IS_ARRAY_TYPE(json_struct)) {
+        if (((SimjsonArray *) json_struct)->size == 1) {
+            child = simjson_array_get(json_struct, 0);
+        }
+    }
+    else if (SIMJSON_IS_OBJECT_TYPE(json_struct) && ((SimjsonObject *) json_struct)->item_size == 1) {
+        SimjsonObjectIterator iterator;
+        if (simjson_object_iterator_init(&iterator, json_struct)) {
+            child = simjson_object_iterator_next(&iterator, NULL, NULL);
+        }
+    }
+    return SIMJSON_IS_ARRAY_TYPE(child) || SIMJSON_IS_OBJECT_TYPE(child) ? child : NULL;
+}
+
+//单元素外层容器的左括号，以及唯一元素之前的缩进与键，depth为容器所在层级
+SIMJSON_PRIVATE bool encode_wrapper_open(JsonBuf *json_buf, const EncodeFormat *format, size_t depth,
+                                         void *json_struct) {
+    if (SIMJSON_IS_ARRAY_TYPE(json_struct)) {
+        return json_buf_append(json_buf, "[", 1) && encode_item_prefix(json_buf, format, depth + 1, 0);
+    }
+
+    SimjsonObjectIterator iterator;
+    if (!simjson_object_iterator_init(&iterator, json_struct)) {
+        return false;
+    }
+    simjson_object_iterator_next(&iterator, NULL, NULL);
+    size_t key_fragment_length;
+    const char *key_fragment = simjson_object_iterator_key_fragment(&iterator, &key_fragment_length);
+    return json_buf_append(json_buf, "{", 1) && encode_item_prefix(json_buf, format, depth + 1, 0) &&
+           json_buf_append(json_buf, key_fragment, key_fragment_length_for(format, key_fragment_length));
+}
+
+//从顶层沿单元素容器逐层向内（如{"data": [...]}），把第一个有多个元素的容器均分为thread_count段并行编码，
+//再由当前线程按顺序拼接并补上外层容器的括号与键，输出与encode_with_format逐字节相同
+//路径上有可复用的缓存时直接顺序编码；拼接后与顺序编码一样保存路径上容器的缓存，元素的缓存由各线程保存
+SIMJSON_PRIVATE char *encode_parallel(void *json_struct, const EncodeFormat *format, size_t thread_count,
+                                      size_t *json_str_length) {
+    void *split = json_struct;
+    size_t depth = 0;
+    while (!cache_valid_for(simjson_encode_cache_of(split), format)) {
+        void *child = only_child_container(split);
+        if (child == NULL) {
+            break;
+        }
+        split = child;
+        depth++;
+    }
+
+    bool is_array = SIMJSON_IS_ARRAY_TYPE(split);
+    size_t item_count = 0;
+    if (cache_valid_for(simjson_encode_cache_of(split), format)) {
+        return encode_with_format(json_struct, format, json_str_length);
+    }
+    else if (is_array) {
+        item_count = ((SimjsonArray *) split)->size;
+    }
+    else if (SIMJSON_IS_OBJECT_TYPE(split)) {
+        item_count = ((SimjsonObject *) split)->item_size;
+    }
+
+    if (thread_count > item_count / PARALLEL_MIN_ITEMS_PER_THREAD) {
+        thread_count = item_count / PARALLEL_MIN_ITEMS_PER_THREAD;
+    }
+    if (thread_count <= 1) {
+        return encode_with_format(json_struct, format, json_str_length);
+    }
+
+    //各线程保存元素的缓存时会使祖先的旧缓存失效，先在当前线程完成，避免多个线程同时释放同一个缓存
+    simjson_encode_cache_invalidate(split);
+
+    char *json_str = NULL;
+    ObjectEntry *entries = NULL;
+    JsonBuf *json_buf = NULL;
+    //wrappers[0, depth)是外层容器，wrappers[depth]是被拆分的容器，starts记录各自输出的起始位置
+    void **wrappers = malloc((depth + 1) * sizeof(void *));
+    size_t *starts = malloc((depth + 1) * sizeof(size_t));
+    EncodeRange *ranges = calloc(thread_count, sizeof(EncodeRange));
+    if (wrappers == NULL || starts == NULL || ranges == NULL) {
+        DEBUG_INFO(strerror(errno));
+        goto END;
+    }
+    wrappers[0] = json_struct;
+    for (size_t i = 1; i <= depth; i++) {
+        wrappers[i] = only_child_container(wrappers[i - 1]);
+    }
+
+    SimjsonArrayIterator iterator;
+    if (is_array) {
+        if (!simjson_array_iterator_init(&iterator, split, 0)) {
+            goto END;
+        }
+    }
+    else {
+        entries = object_entries(split, format->sort_keys);
+        if (entries == NULL) {
+            goto END;
+        }
+    }
+
+    //前item_count % thread_count段各多分一个元素
+    size_t start = 0;
+    for (size_t i = 0; i < thread_count; i++) {
+        EncodeRange *range = &ranges[i];
+        range->format = format;
+        range->depth = depth;
+        range->entries = entries;
+        range->start = start;
+        range->count = item_count / thread_count + (i < item_count % thread_count);
+        start += range->count;
+
+        if (is_array) {
+            //迭代器是值类型，复制一份即是该段的起点
+            range->iterator = iterator;
+            for (size_t j = 0; j < range->count; j++) {
+                simjson_array_iterator_next(&iterator, NULL);
+            }
+        }
+    }
+
+    encode_pool_submit(ranges, thread_count);
+
+    //各段之外的括号、键与缩进先写入只计长度的固定缓冲区，得到输出的精确长度
+    JsonBuf counter;
+    json_buf_init_fixed(&counter, NULL, 0);
+    for (size_t i = 0; i < depth; i++) {
+        encode_wrapper_open(&counter, format, i, wrappers[i]);
+        encode_close(&counter, format, i, "]");
+    }
+    json_buf_append(&counter, "[", 1);
+    encode_close(&counter, format, depth, "]");
+    size_t size = counter.length;
+    for (size_t i = 0; i < thread_count; i++) {
+        if (!ranges[i].success) {
+            DEBUG_INFO("encode failed");
+            goto END;
+        }
+        size += ranges[i].json_buf->length;
+    }
+
+    json_buf = json_buf_new(size + 1, NULL, NULL);
+    if (json_buf == NULL) {
+        goto END;
+    }
+    bool saving = cache_saving(json_buf, format);
+    for (size_t i = 0; i < depth; i++) {
+        starts[i] = json_buf->length;
+        if (!encode_wrapper_open(json_buf, format, i, wrappers[i])) {
+            goto END;
+        }
+    }
+
+    //各段中元素的缓存位置平移到拼接后的位置，被拆分的容器与外层容器的缓存由此引用
+    starts[depth] = json_buf->length;
+    if (!json_buf_append(json_buf, is_array ? "[" : "{", 1)) {
+        goto END;
+    }
+    for (size_t i = 0; i < thread_count; i++) {
+        const JsonBuf *range_buf = ranges[i].json_buf;
+        size_t base = json_buf->length;
+        if (!json_buf_append(json_buf, range_buf->buf, range_buf->length)) {
+            goto END;
+        }
+        for (size_t j = 0; saving && j < range_buf->span_count; j++) {
+            const JsonSpan *span = &range_buf->spans[j];
+            if (!json_buf_push_span(json_buf, span->owner, base + span->offset, span->length)) {
+                goto END;
+            }
+        }
+    }
+
+    for (size_t i = depth + 1; i-- > 0;) {
+        if (!encode_close(json_buf, format, i, SIMJSON_IS_ARRAY_TYPE(wrappers[i]) ? "]" : "}") ||
+            (saving && !cache_finish(json_buf, format, wrappers[i], starts[i], 0))) {
+            goto END;
+        }
+    }
+
+    assert(json_buf->length == size);
+    json_str = json_buf_release(json_buf, json_str_length);
+    json_buf = NULL;
+
+    END:
+    if (json_buf != NULL) {
+        json_buf_free(json_buf);
+    }
+    if (ranges != NULL) {
+        for (size_t i = 0; i < thread_count; i++) {
+            if (ranges[i].json_buf != NULL) {
+                json_buf_free(ranges[i].json_buf);
+            }
+        }
+    }
+    free(ranges);
+    free(starts);
+    free(wrappers);
+    free(entries);
+    return json_str;
+}
+
 /*
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
  */
@@ -266,24 +1195,278 @@ SIMJSON_PUBLIC char *simjson_encode(void *json_struct, size_t *json_str_length)
         return NULL;
     }
 
-    JsonBuf *json_buf = json_buf_new();
+    return encode_with_format(json_struct, &DEFAULT_FORMAT, json_str_length);
+}
+
+SIMJSON_PUBLIC char *simjson_encode_ex(void *json_struct, const SimjsonEncodeOptions *options,
+                                       size_t *json_str_length) {
+    if (json_struct == NULL) {
+        DEBUG_INFO("json_struct is NULL");
+        return NULL;
+    }
+
+    EncodeFormat format;
+    if (!resolve_format(options, &format)) {
+        return NULL;
+    }
+
+    return encode_with_format(json_struct, &format, json_str_length);
+}
+
+SIMJSON_PUBLIC char *simjson_encode_parallel(void *json_struct, const SimjsonEncodeOptions *options,
+                                             size_t thread_count, size_t *json_str_length) {
+    if (json_struct == NULL) {
+        DEBUG_INFO("json_struct is NULL");
+        return NULL;
+    }
+
+    EncodeFormat format;
+    if (!resolve_format(options, &format)) {
+        return NULL;
+    }
+
+    if (thread_count == 0) {
+        long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_count = cpu_count > 0 ? (size_t) cpu_count : 1;
+    }
+
+    return encode_parallel(json_struct, &format, thread_count, json_str_length);
+}
+
+SIMJSON_PUBLIC size_t simjson_encoded_size(void *json_struct) {
+    if (json_struct == NULL) {
+        DEBUG_INFO("json_struct is NULL");
+        return 0;
+    }
+
+    size_t size = 0;
+    if (!encoded_size(&DEFAULT_FORMAT, 0, json_struct, &size)) {
+        return 0;
+    }
+    return size;
+}
+
+SIMJSON_PUBLIC bool simjson_encode_into(void *json_struct, char *buf, size_t size, size_t *needed) {
+    if (json_struct == NULL) {
+        DEBUG_INFO("json_struct is NULL");
+        return false;
+    }
+
+    if (buf == NULL && size != 0) {
+        DEBUG_INFO("buf is NULL");
+        return false;
+    }
+
+    JsonBuf json_buf;
+    json_buf_init_fixed(&json_buf, buf, size);
+    bool success = encode(&json_buf, &DEFAULT_FORMAT, 0, json_struct);
+    json_buf_free_fixed(&json_buf);
+    if (!success) {
+        DEBUG_INFO("encode failed");
+        return false;
+    }
+
+    if (needed != NULL) {
+        *needed = json_buf.length;
+    }
+    if (json_buf.length >= size) {
+        return false;
+    }
+    buf[json_buf.length] = '\0';
+    return true;
+}
+
+SIMJSON_PUBLIC bool simjson_encode_to_sink(void *json_struct, SimjsonSink sink, void *sink_ctx) {
+    if (json_struct == NULL || sink == NULL) {
+        DEBUG_INFO("json_struct or sink is NULL");
+        return false;
+    }
+
+    JsonBuf *json_buf = json_buf_new(SINK_BUF_SIZE, sink, sink_ctx);
     if (json_buf == NULL) {
+        return false;
+    }
+
+    //无法启动后台线程时仍在当前线程同步输出
+    AsyncSink async_sink;
+    bool async = async_sink_start(&async_sink, json_buf, sink, sink_ctx);
+
+    bool success = encode(json_buf, &DEFAULT_FORMAT, 0, json_struct) && json_buf_flush(json_buf);
+    if (async && !async_sink_stop(&async_sink)) {
+        success = false;
+    }
+    if (!success) {
+        DEBUG_INFO("encode failed");
+    }
+    json_buf_free(json_buf);
+    return success;
+}
+
+SIMJSON_PUBLIC bool simjson_encode_to_fd(void *json_struct, int fd) {
+    if (fd < 0) {
+        DEBUG_INFO("invalid fd");
+        return false;
+    }
+    return simjson_encode_to_sink(json_struct, fd_sink, &fd);
+}
+
+SIMJSON_PUBLIC SimjsonGather *simjson_encode_gather(void *json_struct, const SimjsonEncodeOptions *options) {
+    if (json_struct == NULL) {
+        DEBUG_INFO("json_struct is NULL");
         return NULL;
     }
 
-    bool success = encode(json_buf, json_struct);
-    if (success) {
-        char *json_str = json_buf_to_string(json_buf);
-        if (json_str != NULL) {
-            if (json_str_length != NULL) {
-                *json_str_length = json_buf->length;
+    EncodeFormat format;
+    if (!resolve_format(options, &format)) {
+        return NULL;
+    }
+
+    SimjsonGather *gather = malloc(sizeof(SimjsonGather));
+    if (gather == NULL) {
+        DEBUG_INFO(strerror(errno));
+        return NULL;
+    }
+    gather->iov = NULL;
+    gather->iov_count = 0;
+    gather->length = 0;
+
+    gather->json_buf = json_buf_new(GATHER_BUF_SIZE, NULL, NULL);
+    if (gather->json_buf == NULL) {
+        free(gather);
+        return NULL;
+    }
+
+    JsonBuf *json_buf = gather->json_buf;
+    if (!json_buf_enable_segments(json_buf, GATHER_SEGMENT_CAPACITY) ||
+        !encode(json_buf, &format, 0, json_struct) ||
+        !json_buf_close_segment(json_buf)) {
+        goto FAILED;
+    }
+
+    //buf在编码过程中可能被realloc，全部完成后才能把偏移换成指针
+    gather->iov = malloc(json_buf->segment_count * sizeof(struct iovec));
+    if (gather->iov == NULL) {
+        DEBUG_INFO(strerror(errno));
+        goto FAILED;
+    }
+    for (size_t i = 0; i < json_buf->segment_count; i++) {
+        JsonSegment *segment = &json_buf->segments[i];
+        const char *data = segment->data != NULL ? segment->data : json_buf->buf + segment->offset;
+        gather->iov[i].iov_base = (void *) data;
+        gather->iov[i].iov_len = segment->length;
+        gather->length += segment->length;
+    }
+    gather->iov_count = json_buf->segment_count;
+
+    return gather;
+
+    FAILED:
+    simjson_gather_free(gather);
+    return NULL;
+}
+
+SIMJSON_PUBLIC const struct iovec *simjson_gather_iovec(const SimjsonGather *gather, size_t *count) {
+    if (gather == NULL) {
+        DEBUG_INFO("gather is NULL");
+        return NULL;
+    }
+    if (count != NULL) {
+        *count = gather->iov_count;
+    }
+    return gather->iov;
+}
+
+SIMJSON_PUBLIC size_t simjson_gather_length(const SimjsonGather *gather) {
+    return gather == NULL ? 0 : gather->length;
+}
+
+SIMJSON_PUBLIC bool simjson_gather_write(const SimjsonGather *gather, int fd) {
+    if (gather == NULL) {
+        DEBUG_INFO("gather is NULL");
+        return false;
+    }
+
+    struct iovec batch[GATHER_WRITE_BATCH];
+    size_t index = 0;
+    //iov[index]中已经写出的字节数
+    size_t offset = 0;
+    while (index < gather->iov_count) {
+        size_t batch_count = 0;
+        for (; batch_count < GATHER_WRITE_BATCH && index + batch_count < gather->iov_count; batch_count++) {
+            batch[batch_count] = gather->iov[index + batch_count];
+        }
+        batch[0].iov_base = (char *) batch[0].iov_base + offset;
+        batch[0].iov_len -= offset;
+
+        ssize_t written = writev(fd, batch, (int) batch_count);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
             }
+            DEBUG_INFO(strerror(errno));
+            return false;
+        }
+
+        //部分写出时从断点继续
+        size_t remaining = (size_t) written;
+        while (index < gather->iov_count && remaining >= gather->iov[index].iov_len - offset) {
+            remaining -= gather->iov[index].iov_len - offset;
+            index++;
+            offset = 0;
         }
+        offset += remaining;
+    }
+    return true;
+}
+
+SIMJSON_PUBLIC void simjson_gather_free(SimjsonGather *gather) {
+    if (gather == NULL) {
+        return;
+    }
+    if (gather->json_buf != NULL) {
+        json_buf_free(gather->json_buf);
+    }
+    free(gather->iov);
+    free(gather);
+}
+
+SIMJSON_PRIVATE char *encode_from_with_format(const SimjsonSchema *schema, const void *struct_ptr,
+                                              const EncodeFormat *format, size_t *json_str_length) {
+    JsonBuf *json_buf = json_buf_new(BUF_INITIAL_SIZE, NULL, NULL);
+    if (json_buf == NULL) {
+        return NULL;
+    }
+
+    if (!encode_struct(json_buf, format, 0, schema, struct_ptr)) {
+        DEBUG_INFO("encode from struct failed");
         json_buf_free(json_buf);
-        return json_str;
+        return NULL;
     }
 
-    DEBUG_INFO("encode failed");
-    json_buf_free(json_buf);
-    return NULL;
+    return json_buf_release(json_buf, json_str_length);
+}
+
+SIMJSON_PUBLIC char *simjson_encode_from(const SimjsonSchema *schema, const void *struct_ptr,
+                                         size_t *json_str_length) {
+    if (schema == NULL || struct_ptr == NULL) {
+        DEBUG_INFO("schema or struct_ptr is NULL");
+        return NULL;
+    }
+
+    return encode_from_with_format(schema, struct_ptr, &DEFAULT_FORMAT, json_str_length);
+}
+
+SIMJSON_PUBLIC char *simjson_encode_from_ex(const SimjsonSchema *schema, const void *struct_ptr,
+                                            const SimjsonEncodeOptions *options, size_t *json_str_length) {
+    if (schema == NULL || struct_ptr == NULL) {
+        DEBUG_INFO("schema or struct_ptr is NULL");
+        return NULL;
+    }
+
+    EncodeFormat format;
+    if (!resolve_format(options, &format)) {
+        return NULL;
+    }
+
+    return encode_from_with_format(schema, struct_ptr, &format, json_str_length);
 }
@@ -2,131 +2,816 @@
 #include <stdio.h>
 #include <errno.h>
 #include <memory.h>
+#include <time.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "simjson_object.h"
 #include "simjson_type.h"
+#include "json_buf.h"
 #include "log.h"
 
 /*
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
  */
 
-//todo 负载因子太大时怎么办？
-//todo solution 1. 由用户在decode时传入BUCKET_SIZE参考值
-//todo solution 2. 负载因子过大时，创建一个更大的哈希表，然后重哈希
-//todo solution 3. decode时若检测到是object，先遍历object，获取键值对数量，根据数量来决定BUCKET_SIZE
-const static uint8_t BUCKET_SIZE = 64;
+//键值对按插入顺序存放在items中，另建开放寻址索引表，槽位记录键值对在items中的下标
+//索引表每个槽位对应一个控制字节，探测时一次比较一组(16个)控制字节
+//控制字节最高位为1表示槽位未被占用，否则低7位是键哈希的低7位
+#define GROUP_SIZE 16
+#define CTRL_EMPTY 0x80
+#define CTRL_DELETED 0xFE
+
+const static size_t DEFAULT_CAPACITY = 16;
+
+//键值对不超过SMALL_MAX_ITEMS个时不建索引(ctrl为NULL)，线性查找items
+const static size_t SMALL_MAX_ITEMS = 8;
+const static size_t SMALL_MIN_CAPACITY = 4;
+
+//键、'\0'与键片段总长不超过KEY_INLINE_SIZE时直接存放在键值对中，不单独分配
+#define KEY_INLINE_SIZE 32
+
+//冻结时平均每个桶的键数，位移搜索失败时桶数加倍重试
+const static size_t FROZEN_KEYS_PER_BUCKET = 3;
+const static int FROZEN_BUILD_ATTEMPTS = 4;
 
 /*
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
  */
 
+//json_struct为NULL表示已删除留下的空位
+//键值对会随items移动，因此内联的键不能用指针引用，通过object_item_key获取
 struct SimjsonObjectItem {
-    struct SimjsonObjectItem *next;
-    char *key;
+    //键的完整哈希，查找时先比较哈希，重建索引表时不再读取键
+    //小object不建索引也不计算哈希，转换为哈希表时补齐
+    uint64_t hash;
+    //键以'\0'结尾，其后紧跟插入时生成的已转义片段"\"key\": "，编码键只需一次拷贝
+    //借用的键引用调用者的内存，片段单独分配
+    union {
+        struct {
+            char *ptr;
+            char *fragment;
+        } ref;
+        char inline_key[KEY_INLINE_SIZE];
+    } key;
     size_t key_length;
+    size_t key_fragment_length;
+    bool key_inline;
+    bool key_borrowed;
+    //键与片段已拷贝到冻结时拼接的key_blob中，由key_blob统一释放
+    bool key_packed;
     void *json_struct;
 };
 
+//冻结后的只读索引，CHD最小完美哈希
+//键按哈希分桶，每个桶选一个位移，使桶内所有键映射到互不冲突的位置，位置数等于键值对数
+//displacements为NULL表示小object，冻结后仍线性查找
+struct SimjsonObjectFrozen {
+    uint32_t *displacements;
+    size_t bucket_count;
+    //位置上的键值对在items中的下标
+    uint32_t *positions;
+    //单独分配的键拼接成一块，冻结后键值对中的键指向这里
+    char *key_blob;
+};
+
 /*
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
  */
 
-SIMJSON_PRIVATE SimjsonObjectItem *simjson_object_item_new(const char *key, size_t key_length, void *json_struct) {
-    SimjsonObjectItem *item = malloc(sizeof(SimjsonObjectItem));
-    if (item == NULL) {
-        DEBUG_INFO(strerror(errno));
-        return NULL;
-    }
+SIMJSON_PRIVATE inline char *object_item_key(SimjsonObjectItem *item) {
+    return item->key_inline ? item->key.inline_key : item->key.ref.ptr;
+}
 
-    item->key = malloc(sizeof(key_length + 1));
-    if (item->key == NULL) {
-        DEBUG_INFO(strerror(errno));
-        free(item);
-        return NULL;
+SIMJSON_PRIVATE inline const char *object_item_fragment(SimjsonObjectItem *item) {
+    return item->key_inline ? item->key.inline_key + item->key_length + 1 : item->key.ref.fragment;
+}
+
+//短键即使是借用的也直接拷贝，连同片段存放在键值对中
+SIMJSON_PRIVATE bool object_item_init(SimjsonObjectItem *item, const char *key, size_t key_length, void *json_struct,
+                                      bool key_borrowed, uint64_t hash) {
+    size_t fragment_length = json_escaped_length(key, key_length) + 4;
+    item->key_inline = key_length + 1 + fragment_length <= KEY_INLINE_SIZE;
+    item->key_borrowed = key_borrowed && !item->key_inline;
+    item->key_packed = false;
+
+    char *fragment;
+    if (item->key_inline) {
+        memcpy(item->key.inline_key, key, key_length);
+        item->key.inline_key[key_length] = '\0';
+        fragment = item->key.inline_key + key_length + 1;
+    }
+    else if (item->key_borrowed) {
+        fragment = malloc(fragment_length);
+        if (fragment == NULL) {
+            DEBUG_INFO(strerror(errno));
+            return false;
+        }
+        item->key.ref.ptr = (char *) key;
+        item->key.ref.fragment = fragment;
+    }
+    else {
+        char *block = malloc(key_length + 1 + fragment_length);
+        if (block == NULL) {
+            DEBUG_INFO(strerror(errno));
+            return false;
+        }
+        memcpy(block, key, key_length);
+        block[key_length] = '\0';
+        fragment = block + key_length + 1;
+        item->key.ref.ptr = block;
+        item->key.ref.fragment = fragment;
     }
-    memcpy(item->key, key, key_length);
-    item->key[key_length] = '\0';
+
+    fragment[0] = '\"';
+    memcpy(json_write_escaped(fragment + 1, key, key_length), "\": ", 3);
+
+    item->hash = hash;
     item->key_length = key_length;
+    item->key_fragment_length = fragment_length;
     item->json_struct = json_struct;
-    item->next = NULL;
 
-    return item;
+    return true;
+}
+
+//只释放键，值仍归调用者
+SIMJSON_PRIVATE void object_item_release_key(SimjsonObjectItem *item) {
+    if (item->key_inline || item->key_packed) {
+        return;
+    }
+    if (item->key_borrowed) {
+        free(item->key.ref.fragment);
+    }
+    else {
+        free(item->key.ref.ptr);
+    }
 }
 
-SIMJSON_PRIVATE void simjson_object_item_free(SimjsonObjectItem *item) {
+SIMJSON_PRIVATE void object_item_release(SimjsonObjectItem *item) {
     simjson_free_json_struct(item->json_struct);
-    free(item->key);
-    free(item);
+    object_item_release_key(item);
+}
+
+//进程级随机种子，使外部输入无法预先构造大量冲突的键
+//进程启动时由hash_seed_init设置，之后只读，已与HASH_SECRET混合
+static uint64_t hash_seed;
+
+const static uint64_t HASH_SECRET[4] = {
+        0xa0761d6478bd642full, 0xe7037ed1a0b428dbull, 0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull
+};
+
+//64位乘法的128位结果，低64位写入a，高64位写入b
+SIMJSON_PRIVATE inline void hash_mum(uint64_t *a, uint64_t *b) {
+#ifdef __SIZEOF_INT128__
+    __uint128_t r = (__uint128_t) *a * *b;
+    *a = (uint64_t) r;
+    *b = (uint64_t) (r >> 64);
+#else
+    uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t) *a, lb = (uint32_t) *b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32);
+    uint64_t c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
 }
 
-//djb2
-SIMJSON_PRIVATE unsigned long hash_func(unsigned char *str, size_t length) {
-    unsigned long hash = 5381;
-    int c;
-    size_t cur_length = length;
+SIMJSON_PRIVATE inline uint64_t hash_mix(uint64_t a, uint64_t b) {
+    hash_mum(&a, &b);
+    return a ^ b;
+}
 
-    while (cur_length--) {
-        c = *str++;
-        // hash * 33 + c
-        hash = ((hash << 5) + hash) + c;
+//库加载时执行一次，哈希时无需再检查种子是否已初始化
+__attribute__((constructor)) SIMJSON_PRIVATE void hash_seed_init(void) {
+    uint64_t seed = 0;
+    FILE *file = fopen("/dev/urandom", "rb");
+    if (file != NULL) {
+        if (fread(&seed, sizeof(seed), 1, file) != 1) {
+            seed = 0;
+        }
+        fclose(file);
     }
-    return hash;
+    //没有/dev/urandom时退化为时间与地址随机化的组合
+    if (seed == 0) {
+        seed = (uint64_t) time(NULL) ^ (uint64_t) (uintptr_t) &seed ^ (uint64_t) clock() << 32;
+    }
+    hash_seed = seed ^ hash_mix(seed ^ HASH_SECRET[0], HASH_SECRET[1]);
 }
 
-/*
- * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
- */
+SIMJSON_PRIVATE inline uint64_t read64(const unsigned char *p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
 
-SIMJSON_PUBLIC SimjsonObject *simjson_object_new(size_t bucket_size) {
-    if (bucket_size == 0) {
-        bucket_size = BUCKET_SIZE;
+SIMJSON_PRIVATE inline uint64_t read32(const unsigned char *p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+//wyhash，每次处理8字节，长键按48字节分三路并行混合
+SIMJSON_PRIVATE uint64_t hash_func(const char *key, size_t length) {
+    const unsigned char *p = (const unsigned char *) key;
+    uint64_t seed = hash_seed;
+    uint64_t a, b;
+
+    if (length <= 16) {
+        if (length >= 4) {
+            a = (read32(p) << 32) | read32(p + ((length >> 3) << 2));
+            b = (read32(p + length - 4) << 32) | read32(p + length - 4 - ((length >> 3) << 2));
+        }
+        else if (length > 0) {
+            a = ((uint64_t) p[0] << 16) | ((uint64_t) p[length >> 1] << 8) | p[length - 1];
+            b = 0;
+        }
+        else {
+            a = b = 0;
+        }
+    }
+    else {
+        size_t i = length;
+        if (i > 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = hash_mix(read64(p) ^ HASH_SECRET[1], read64(p + 8) ^ seed);
+                see1 = hash_mix(read64(p + 16) ^ HASH_SECRET[2], read64(p + 24) ^ see1);
+                see2 = hash_mix(read64(p + 32) ^ HASH_SECRET[3], read64(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = hash_mix(read64(p) ^ HASH_SECRET[1], read64(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = read64(p + i - 16);
+        b = read64(p + i - 8);
     }
 
-    SimjsonObject *object = malloc(sizeof(SimjsonObject));
-    if (object == NULL) {
+    a ^= HASH_SECRET[1];
+    b ^= seed;
+    hash_mum(&a, &b);
+    return hash_mix(a ^ HASH_SECRET[0] ^ length, b ^ HASH_SECRET[1]);
+}
+
+//一组控制字节中等于byte的位置掩码
+SIMJSON_PRIVATE inline uint32_t group_match(const uint8_t *group, uint8_t byte) {
+#ifdef __SSE2__
+    __m128i ctrl = _mm_loadu_si128((const __m128i *) group);
+    return (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char) byte)));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < GROUP_SIZE; i++) {
+        mask |= (uint32_t) (group[i] == byte) << i;
+    }
+    return mask;
+#endif
+}
+
+//一组控制字节中空或已删除槽位的掩码
+SIMJSON_PRIVATE inline uint32_t group_match_free(const uint8_t *group) {
+#ifdef __SSE2__
+    return (uint32_t) _mm_movemask_epi8(_mm_loadu_si128((const __m128i *) group));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < GROUP_SIZE; i++) {
+        mask |= (uint32_t) (group[i] >> 7) << i;
+    }
+    return mask;
+#endif
+}
+
+//负载因子上限7/8，已删除的槽位同样占用
+//items的容量同为7/8，索引表中已占用与已删除的槽位都对应items中的一个位置，因此总有空槽位
+SIMJSON_PRIVATE inline size_t max_load(size_t capacity) {
+    return capacity - capacity / 8;
+}
+
+//能容纳item_size个键值对的最小索引表容量，超出uint32_t时由resize报错
+SIMJSON_PRIVATE size_t capacity_for(size_t item_size) {
+    size_t capacity = DEFAULT_CAPACITY;
+    while (max_load(capacity) < item_size && capacity <= UINT32_MAX) {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+//以组为单位三角探测，组数是2的幂，因此会遍历所有组
+SIMJSON_PRIVATE size_t find_slot(const SimjsonObject *object, const char *key, size_t key_length,
+                                 uint64_t hash) {
+    size_t group_mask = object->capacity / GROUP_SIZE - 1;
+    size_t group = (hash >> 7) & group_mask;
+    uint8_t h2 = hash & 0x7F;
+
+    for (size_t stride = 1; stride <= group_mask + 1; stride++) {
+        const uint8_t *ctrl = object->ctrl + group * GROUP_SIZE;
+        uint32_t match = group_match(ctrl, h2);
+        while (match) {
+            size_t slot = group * GROUP_SIZE + __builtin_ctz(match);
+            SimjsonObjectItem *item = &object->items[object->slots[slot]];
+            if (item->hash == hash && item->key_length == key_length &&
+                memcmp(object_item_key(item), key, key_length) == 0) {
+                return slot;
+            }
+            match &= match - 1;
+        }
+        //插入时只有整组都被占用才会继续探测，遇到空槽位说明键不存在
+        if (group_match(ctrl, CTRL_EMPTY)) {
+            break;
+        }
+        group = (group + stride) & group_mask;
+    }
+    return object->capacity;
+}
+
+SIMJSON_PRIVATE size_t find_insert_slot(const SimjsonObject *object, uint64_t hash) {
+    size_t group_mask = object->capacity / GROUP_SIZE - 1;
+    size_t group = (hash >> 7) & group_mask;
+
+    for (size_t stride = 1; ; stride++) {
+        uint32_t match = group_match_free(object->ctrl + group * GROUP_SIZE);
+        if (match) {
+            return group * GROUP_SIZE + __builtin_ctz(match);
+        }
+        group = (group + stride) & group_mask;
+    }
+}
+
+//先比较长度与首字节，多数不同的键无需调用memcmp
+//不存在时返回item_count
+SIMJSON_PRIVATE size_t small_find(const SimjsonObject *object, const char *key, size_t key_length) {
+    for (size_t i = 0; i < object->item_count; i++) {
+        SimjsonObjectItem *item = &object->items[i];
+        const char *item_key = object_item_key(item);
+        if (item->key_length == key_length && item_key[0] == key[0] && memcmp(item_key, key, key_length) == 0) {
+            return i;
+        }
+    }
+    return object->item_count;
+}
+
+SIMJSON_PRIVATE bool small_grow(SimjsonObject *object) {
+    size_t capacity = object->capacity < SMALL_MIN_CAPACITY ? SMALL_MIN_CAPACITY : object->capacity * 2;
+    if (capacity > SMALL_MAX_ITEMS) {
+        capacity = SMALL_MAX_ITEMS;
+    }
+    SimjsonObjectItem *items = realloc(object->items, capacity * sizeof(SimjsonObjectItem));
+    if (items == NULL) {
+        DEBUG_INFO(strerror(errno));
+        return false;
+    }
+    object->items = items;
+    object->capacity = capacity;
+    return true;
+}
+
+//压缩掉items中已删除的空位并重新填充索引表，键值对的相对顺序不变，不分配内存
+//compute_hash为true时补齐小object的键哈希
+SIMJSON_PRIVATE void reindex(SimjsonObject *object, bool compute_hash) {
+    memset(object->ctrl, CTRL_EMPTY, object->capacity);
+
+    size_t item_count = 0;
+    for (size_t i = 0; i < object->item_count; i++) {
+        if (object->items[i].json_struct == NULL) {
+            continue;
+        }
+        SimjsonObjectItem *item = &object->items[item_count];
+        *item = object->items[i];
+        if (compute_hash) {
+            item->hash = hash_func(object_item_key(item), item->key_length);
+        }
+        size_t slot = find_insert_slot(object, item->hash);
+        object->ctrl[slot] = item->hash & 0x7F;
+        object->slots[slot] = item_count;
+        item_count++;
+    }
+    object->item_count = item_count;
+}
+
+//按新容量重建索引表
+//小object在这里转换为哈希表
+SIMJSON_PRIVATE bool resize(SimjsonObject *object, size_t capacity) {
+    bool small = object->ctrl == NULL;
+    if (capacity > UINT32_MAX) {
+        DEBUG_INFO("object is too large");
+        return false;
+    }
+
+    uint8_t *ctrl = malloc(capacity);
+    uint32_t *slots = malloc(capacity * sizeof(uint32_t));
+    //容量只增不减，realloc失败时原items不变
+    SimjsonObjectItem *items = realloc(object->items, max_load(capacity) * sizeof(SimjsonObjectItem));
+    if (items != NULL) {
+        object->items = items;
+    }
+    if (ctrl == NULL || slots == NULL || items == NULL) {
         DEBUG_INFO(strerror(errno));
+        free(ctrl);
+        free(slots);
+        return false;
+    }
+
+    free(object->ctrl);
+    free(object->slots);
+    object->ctrl = ctrl;
+    object->slots = slots;
+    object->capacity = capacity;
+    reindex(object, small);
+
+    return true;
+}
+
+//哈希高32位映射到桶，低位经位移混合后映射到位置，都用乘法代替取模
+SIMJSON_PRIVATE inline size_t frozen_bucket(uint64_t hash, size_t bucket_count) {
+    return (size_t) (((hash >> 32) * bucket_count) >> 32);
+}
+
+SIMJSON_PRIVATE inline size_t frozen_position(uint64_t hash, uint32_t displacement, size_t item_size) {
+    uint64_t mixed = hash_mix(hash ^ HASH_SECRET[2], displacement + HASH_SECRET[3]);
+    return (size_t) (((mixed & 0xFFFFFFFF) * item_size) >> 32);
+}
+
+SIMJSON_PRIVATE int frozen_bucket_compare(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *) a;
+    uint64_t y = *(const uint64_t *) b;
+    return x < y ? 1 : (x > y ? -1 : 0);
+}
+
+//为紧凑的items构建位移表，桶内有哈希完全相同的键或位移超出上限时失败
+SIMJSON_PRIVATE bool frozen_build(SimjsonObjectFrozen *frozen, const SimjsonObjectItem *items, size_t item_size,
+                                  size_t bucket_count) {
+    bool success = false;
+    uint32_t *displacements = calloc(bucket_count, sizeof(uint32_t));
+    uint32_t *positions = malloc((item_size + 1) * sizeof(uint32_t));
+    uint32_t *bucket_start = calloc(bucket_count + 1, sizeof(uint32_t));
+    uint32_t *members = malloc((item_size + 1) * sizeof(uint32_t));
+    uint32_t *candidates = malloc((item_size + 1) * sizeof(uint32_t));
+    //高32位是桶大小，低32位是桶号，降序排列后先放大桶
+    uint64_t *order = malloc(bucket_count * sizeof(uint64_t));
+    if (displacements == NULL || positions == NULL || bucket_start == NULL || members == NULL ||
+        candidates == NULL || order == NULL) {
+        DEBUG_INFO(strerror(errno));
+        goto FAILED;
+    }
+    memset(positions, 0xFF, item_size * sizeof(uint32_t));
+
+    //按桶计数排序，members[bucket_start[b], bucket_start[b + 1])是桶b中的键值对
+    for (size_t i = 0; i < item_size; i++) {
+        bucket_start[frozen_bucket(items[i].hash, bucket_count) + 1]++;
+    }
+    for (size_t b = 0; b < bucket_count; b++) {
+        order[b] = (uint64_t) bucket_start[b + 1] << 32 | b;
+        bucket_start[b + 1] += bucket_start[b];
+    }
+    for (size_t i = 0; i < item_size; i++) {
+        members[bucket_start[frozen_bucket(items[i].hash, bucket_count)]++] = i;
+    }
+    memmove(bucket_start + 1, bucket_start, bucket_count * sizeof(uint32_t));
+    bucket_start[0] = 0;
+    qsort(order, bucket_count, sizeof(uint64_t), frozen_bucket_compare);
+
+    uint64_t max_displacement = (uint64_t) item_size * 32 + 1024;
+    if (max_displacement > UINT32_MAX) {
+        max_displacement = UINT32_MAX;
+    }
+    for (size_t k = 0; k < bucket_count && order[k] >> 32 != 0; k++) {
+        size_t b = (uint32_t) order[k];
+        const uint32_t *bucket = members + bucket_start[b];
+        size_t size = order[k] >> 32;
+
+        uint32_t displacement = 0;
+        for (;; displacement++) {
+            if (displacement == max_displacement) {
+                goto FAILED;
+            }
+            //逐个占用位置，桶内互相冲突时同样会发现
+            size_t placed = 0;
+            while (placed < size) {
+                size_t position = frozen_position(items[bucket[placed]].hash, displacement, item_size);
+                if (positions[position] != UINT32_MAX) {
+                    break;
+                }
+                positions[position] = bucket[placed];
+                candidates[placed++] = position;
+            }
+            if (placed == size) {
+                break;
+            }
+            while (placed > 0) {
+                positions[candidates[--placed]] = UINT32_MAX;
+            }
+        }
+        displacements[b] = displacement;
+    }
+
+    frozen->displacements = displacements;
+    frozen->positions = positions;
+    frozen->bucket_count = bucket_count;
+    displacements = NULL;
+    positions = NULL;
+    success = true;
+
+FAILED:
+    free(displacements);
+    free(positions);
+    free(bucket_start);
+    free(members);
+    free(candidates);
+    free(order);
+    return success;
+}
+
+//一次哈希，一次比较
+SIMJSON_PRIVATE SimjsonObjectItem *frozen_find(const SimjsonObject *object, const char *key, size_t key_length,
+                                               uint64_t hash) {
+    const SimjsonObjectFrozen *frozen = object->frozen;
+    if (object->item_size == 0) {
         return NULL;
     }
+    uint32_t displacement = frozen->displacements[frozen_bucket(hash, frozen->bucket_count)];
+    SimjsonObjectItem *item = &object->items[frozen->positions[frozen_position(hash, displacement, object->item_size)]];
+    if (item->hash == hash && item->key_length == key_length && memcmp(object_item_key(item), key, key_length) == 0) {
+        return item;
+    }
+    return NULL;
+}
+
+//把单独分配的键拷贝到一块连续内存，分配失败时保持原样
+SIMJSON_PRIVATE void frozen_pack_keys(SimjsonObject *object, SimjsonObjectFrozen *frozen) {
+    size_t blob_length = 0;
+    for (size_t i = 0; i < object->item_count; i++) {
+        const SimjsonObjectItem *item = &object->items[i];
+        if (!item->key_inline && !item->key_borrowed && !item->key_packed) {
+            blob_length += item->key_length + 1 + item->key_fragment_length;
+        }
+    }
+    if (blob_length == 0) {
+        return;
+    }
+
+    char *blob = malloc(blob_length);
+    if (blob == NULL) {
+        DEBUG_INFO(strerror(errno));
+        return;
+    }
+
+    char *cur = blob;
+    for (size_t i = 0; i < object->item_count; i++) {
+        SimjsonObjectItem *item = &object->items[i];
+        if (!item->key_inline && !item->key_borrowed && !item->key_packed) {
+            size_t length = item->key_length + 1 + item->key_fragment_length;
+            memcpy(cur, item->key.ref.ptr, length);
+            free(item->key.ref.ptr);
+            item->key.ref.ptr = cur;
+            item->key.ref.fragment = cur + item->key_length + 1;
+            item->key_packed = true;
+            cur += length;
+        }
+    }
+    frozen->key_blob = blob;
+}
+
+//hash为NULL时在需要时计算，小object查找不需要哈希
+SIMJSON_PRIVATE SimjsonObjectItem *object_find(const SimjsonObject *object, const char *key, size_t key_length,
+                                               const uint64_t *hash) {
+    if (object->frozen != NULL && object->frozen->displacements != NULL) {
+        return frozen_find(object, key, key_length, hash != NULL ? *hash : hash_func(key, key_length));
+    }
+    if (object->ctrl == NULL) {
+        size_t index = small_find(object, key, key_length);
+        return index == object->item_count ? NULL : &object->items[index];
+    }
+    size_t slot = find_slot(object, key, key_length, hash != NULL ? *hash : hash_func(key, key_length));
+    return slot == object->capacity ? NULL : &object->items[object->slots[slot]];
+}
+
+//追加到items末尾，调用者保证键不重复且items还有空间
+//小object不需要hash
+SIMJSON_PRIVATE bool object_insert(SimjsonObject *object, const char *key, size_t key_length, void *json_struct,
+                                   bool key_borrowed, uint64_t hash) {
+    size_t index = object->item_count;
+    if (!object_item_init(&object->items[index], key, key_length, json_struct, key_borrowed, hash)) {
+        return false;
+    }
+    if (object->ctrl != NULL) {
+        size_t slot = find_insert_slot(object, hash);
+        object->ctrl[slot] = hash & 0x7F;
+        object->slots[slot] = index;
+    }
+
+    object->item_count++;
+    object->item_size++;
+
+    return true;
+}
+
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ */
 
-    //不能用malloc
-    object->buckets = calloc(bucket_size, sizeof(struct SimjsonObjectItem *));
-    if (object->buckets == NULL) {
+SIMJSON_PUBLIC SimjsonObject *simjson_object_new(size_t capacity) {
+    SimjsonObject *object = malloc(sizeof(SimjsonObject));
+    if (object == NULL) {
         DEBUG_INFO(strerror(errno));
-        free(object);
         return NULL;
     }
 
-    object->bucket_size = bucket_size;
+    object->items = NULL;
+    object->item_count = 0;
     object->item_size = 0;
+    object->ctrl = NULL;
+    object->slots = NULL;
+    object->capacity = 0;
+    object->frozen = NULL;
     object->type = SIMJSON_OBJECT_TYPE;
+    object->cache = (SimjsonEncodeCache) {NULL, NULL, 0, NULL, 0, 0, 0, false};
+
+    //小object在首次添加时才分配，预计较多时直接建表
+    if (capacity > SMALL_MAX_ITEMS) {
+        if (!resize(object, capacity_for(capacity))) {
+            free(object->items);
+            free(object);
+            return NULL;
+        }
+    }
 
     return object;
 }
 
-SIMJSON_PUBLIC void simjson_object_free(SimjsonObject *object) {
-    size_t remaining_items = object->item_size;
-    size_t cur_bucket_index = 0;
-    SimjsonObjectItem *cur_item = NULL;
-    SimjsonObjectItem *next_item = NULL;
+SIMJSON_PUBLIC SimjsonObject *simjson_object_from_entries(const char *const *keys, const size_t *key_lengths,
+                                                          void *const *values, size_t count, bool unique) {
+    if (count > 0 && (keys == NULL || key_lengths == NULL || values == NULL)) {
+        DEBUG_INFO("entries are NULL");
+        return NULL;
+    }
 
-    while (remaining_items) {
-        cur_item = object->buckets[cur_bucket_index];
-        while (cur_item != NULL) {
-            next_item = cur_item->next;
-            simjson_object_item_free(cur_item);
-            remaining_items--;
-            cur_item = next_item;
+    SimjsonObject *object = simjson_object_new(0);
+    if (object == NULL) {
+        return NULL;
+    }
+    if (!simjson_object_reserve(object, count)) {
+        goto FAILED;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (keys[i] == NULL || key_lengths[i] == 0) {
+            DEBUG_INFO("key is NULL or empty");
+            goto FAILED;
+        }
+        if (values[i] == NULL) {
+            DEBUG_INFO("json_struct is NULL");
+            goto FAILED;
+        }
+
+        //已预留空间，插入时不会扩容
+        uint64_t hash = object->ctrl == NULL ? 0 : hash_func(keys[i], key_lengths[i]);
+        if (!unique) {
+            bool exists = object->ctrl == NULL ? small_find(object, keys[i], key_lengths[i]) != object->item_count
+                                               : find_slot(object, keys[i], key_lengths[i], hash) != object->capacity;
+            if (exists) {
+                DEBUG_INFO("key already exists");
+                goto FAILED;
+            }
+        }
+        if (!object_insert(object, keys[i], key_lengths[i], values[i], false, hash)) {
+            goto FAILED;
         }
-        //cur_bucket_index应该不会越界，因为有检查remaining_items
-        cur_bucket_index++;
     }
 
-    free(object->buckets);
+    //全部插入成功后才接管值
+    for (size_t i = 0; i < count; i++) {
+        simjson_encode_cache_attach(object, values[i]);
+    }
+    return object;
+
+FAILED:
+    for (size_t i = 0; i < object->item_count; i++) {
+        object_item_release_key(&object->items[i]);
+    }
+    free(object->ctrl);
+    free(object->slots);
+    free(object->items);
     free(object);
+    return NULL;
 }
 
-SIMJSON_PUBLIC bool simjson_object_add(SimjsonObject *object, const char *key, size_t key_length, void *json_struct) {
+SIMJSON_PUBLIC bool simjson_object_reserve(SimjsonObject *object, size_t item_size) {
+    if (object == NULL) {
+        DEBUG_INFO("object is NULL");
+        return false;
+    }
+
+    if (object->frozen != NULL) {
+        DEBUG_INFO("object is frozen");
+        return false;
+    }
+
+    if (object->ctrl == NULL && item_size <= SMALL_MAX_ITEMS) {
+        if (item_size <= object->capacity) {
+            return true;
+        }
+        SimjsonObjectItem *items = realloc(object->items, item_size * sizeof(SimjsonObjectItem));
+        if (items == NULL) {
+            DEBUG_INFO(strerror(errno));
+            return false;
+        }
+        object->items = items;
+        object->capacity = item_size;
+        return true;
+    }
+
+    //已删除的空位同样占用items，空间不足时重建会一并压缩
+    if (object->ctrl != NULL) {
+        size_t needed = item_size > object->item_size ? item_size - object->item_size : 0;
+        if (max_load(object->capacity) - object->item_count >= needed) {
+            return true;
+        }
+    }
+    size_t capacity = capacity_for(item_size);
+    return resize(object, capacity > object->capacity ? capacity : object->capacity);
+}
+
+SIMJSON_PUBLIC void simjson_object_free(SimjsonObject *object) {
+    for (size_t i = 0; i < object->item_count; i++) {
+        if (object->items[i].json_struct != NULL) {
+            object_item_release(&object->items[i]);
+        }
+    }
+
+    if (object->frozen != NULL) {
+        free(object->frozen->displacements);
+        free(object->frozen->positions);
+        free(object->frozen->key_blob);
+        free(object->frozen);
+    }
+    simjson_encode_cache_release(&object->cache);
+    free(object->ctrl);
+    free(object->slots);
+    free(object->items);
+    free(object);
+}
+
+SIMJSON_PUBLIC bool simjson_object_freeze(SimjsonObject *object) {
+    if (object == NULL) {
+        DEBUG_INFO("object is NULL");
+        return false;
+    }
+
+    if (object->frozen != NULL) {
+        return true;
+    }
+
+    SimjsonObjectFrozen *frozen = calloc(1, sizeof(SimjsonObjectFrozen));
+    if (frozen == NULL) {
+        DEBUG_INFO(strerror(errno));
+        return false;
+    }
+
+    //小object本身紧凑且没有哈希，只打包键
+    if (object->ctrl != NULL) {
+        //先压缩空位，索引表随之重建，构建失败时object仍可正常使用
+        reindex(object, false);
+        size_t bucket_count = object->item_size / FROZEN_KEYS_PER_BUCKET + 1;
+        bool built = false;
+        for (int attempt = 0; !built && attempt < FROZEN_BUILD_ATTEMPTS; attempt++, bucket_count *= 2) {
+            built = frozen_build(frozen, object->items, object->item_size, bucket_count);
+        }
+        if (!built) {
+            DEBUG_INFO("failed to build perfect hash");
+            free(frozen);
+            return false;
+        }
+
+        free(object->ctrl);
+        free(object->slots);
+        object->ctrl = NULL;
+        object->slots = NULL;
+        //不再增长，items收缩到实际大小，capacity与小object一样表示items的容量
+        object->capacity = object->item_count;
+        SimjsonObjectItem *items = realloc(object->items, object->item_count * sizeof(SimjsonObjectItem));
+        if (items != NULL || object->item_count == 0) {
+            object->items = items;
+        }
+    }
+
+    frozen_pack_keys(object, frozen);
+    object->frozen = frozen;
+
+    return true;
+}
+
+//查找键，不存在时插入json_struct，只计算一次哈希
+//*item指向找到或插入的键值对，键已存在时json_struct仍归调用者
+SIMJSON_PRIVATE bool object_find_or_insert(SimjsonObject *object, const char *key, size_t key_length,
+                                           void *json_struct, bool key_borrowed, SimjsonObjectItem **item,
+                                           bool *inserted) {
     if (object == NULL) {
         DEBUG_INFO("object is NULL");
         return false;
@@ -137,33 +822,165 @@ SIMJSON_PUBLIC bool simjson_object_add(SimjsonObject *object, const char *key, s
         return false;
     }
 
+    if (object->frozen != NULL) {
+        DEBUG_INFO("object is frozen");
+        return false;
+    }
+
+    *inserted = false;
+    uint64_t hash = 0;
+    if (object->ctrl == NULL) {
+        size_t index = small_find(object, key, key_length);
+        if (index != object->item_count) {
+            *item = &object->items[index];
+            return true;
+        }
+
+        if (object->item_count < SMALL_MAX_ITEMS) {
+            if (object->item_count == object->capacity && !small_grow(object)) {
+                return false;
+            }
+        }
+        else {
+            if (!resize(object, DEFAULT_CAPACITY)) {
+                return false;
+            }
+            hash = hash_func(key, key_length);
+        }
+    }
+    else {
+        hash = hash_func(key, key_length);
+        size_t slot = find_slot(object, key, key_length, hash);
+        if (slot != object->capacity) {
+            *item = &object->items[object->slots[slot]];
+            return true;
+        }
+
+        if (object->item_count == max_load(object->capacity)) {
+            //空位较多时原容量压缩即可
+            size_t capacity = object->item_size < max_load(object->capacity) / 2 ? object->capacity
+                                                                                 : object->capacity * 2;
+            if (!resize(object, capacity)) {
+                return false;
+            }
+        }
+    }
+
+    if (!object_insert(object, key, key_length, json_struct, key_borrowed, hash)) {
+        return false;
+    }
+    simjson_encode_cache_attach(object, json_struct);
+    *item = &object->items[object->item_count - 1];
+    *inserted = true;
+
+    return true;
+}
+
+SIMJSON_PRIVATE bool object_add(SimjsonObject *object, const char *key, size_t key_length, void *json_struct,
+                                bool key_borrowed) {
     if (json_struct == NULL) {
         DEBUG_INFO("json_struct is NULL");
         return false;
     }
 
-    //todo 直接调用simjson_object_get的话，计算了两次hash
-    if (simjson_object_get(object, key, key_length) != NULL) {
+    SimjsonObjectItem *item;
+    bool inserted;
+    if (!object_find_or_insert(object, key, key_length, json_struct, key_borrowed, &item, &inserted)) {
+        return false;
+    }
+    if (!inserted) {
         DEBUG_INFO("key already exists");
         return false;
     }
+    return true;
+}
 
-    SimjsonObjectItem *item = simjson_object_item_new(key, key_length, json_struct);
-    if (item == NULL) {
+//值离开object时清除其缓存的parent，避免之后的修改使已无关的object缓存失效
+SIMJSON_PRIVATE void object_value_detach(void *json_struct) {
+    SimjsonEncodeCache *cache = simjson_encode_cache_of(json_struct);
+    if (cache != NULL) {
+        cache->parent = NULL;
+    }
+}
+
+//移除键值对，json_struct为NULL时释放值，否则把值交给调用者
+//键不存在时返回false，report_missing为false时不输出调试信息
+SIMJSON_PRIVATE bool object_remove(SimjsonObject *object, const char *key, size_t key_length, void **json_struct,
+                                   bool report_missing) {
+    if (object == NULL) {
+        DEBUG_INFO("object is NULL");
+        return false;
+    }
+
+    if (key == NULL || key_length == 0) {
+        DEBUG_INFO("key is NULL or empty");
         return false;
     }
 
-    unsigned long key_hash = hash_func((unsigned char *) key, key_length);
-    size_t index = key_hash % (object->bucket_size - 1);
-    SimjsonObjectItem *bucket = object->buckets[index];
-    item->next = bucket;
-    object->buckets[index] = item;
+    if (object->frozen != NULL) {
+        DEBUG_INFO("object is frozen");
+        return false;
+    }
 
-    object->item_size++;
+    size_t index;
+    size_t slot = 0;
+    if (object->ctrl == NULL) {
+        index = small_find(object, key, key_length);
+        if (index == object->item_count) {
+            if (report_missing) {
+                DEBUG_INFO("key does not exists");
+            }
+            return false;
+        }
+    }
+    else {
+        slot = find_slot(object, key, key_length, hash_func(key, key_length));
+        if (slot == object->capacity) {
+            if (report_missing) {
+                DEBUG_INFO("key does not exists");
+            }
+            return false;
+        }
+        index = object->slots[slot];
+    }
+
+    SimjsonObjectItem *item = &object->items[index];
+    if (json_struct == NULL) {
+        object_item_release(item);
+    }
+    else {
+        *json_struct = item->json_struct;
+        object_value_detach(item->json_struct);
+        object_item_release_key(item);
+    }
+
+    if (object->ctrl == NULL) {
+        //后面的键值对前移，保持紧凑与顺序
+        memmove(item, item + 1, (object->item_count - index - 1) * sizeof(SimjsonObjectItem));
+        object->item_count--;
+    }
+    else {
+        //items中留下空位，在下次重建索引表时压缩
+        item->json_struct = NULL;
+
+        //组内还有空槽位时，没有键会越过这一组继续探测，可以直接置空
+        const uint8_t *group = object->ctrl + slot / GROUP_SIZE * GROUP_SIZE;
+        object->ctrl[slot] = group_match(group, CTRL_EMPTY) ? CTRL_EMPTY : CTRL_DELETED;
+    }
+    object->item_size--;
+    simjson_encode_cache_invalidate(object);
 
     return true;
 }
 
+SIMJSON_PUBLIC bool simjson_object_add(SimjsonObject *object, const char *key, size_t key_length, void *json_struct) {
+    return object_add(object, key, key_length, json_struct, false);
+}
+
+SIMJSON_PUBLIC bool simjson_object_add_borrowed(SimjsonObject *object, const char *key, size_t key_length, void *json_struct) {
+    return object_add(object, key, key_length, json_struct, true);
+}
+
 SIMJSON_PUBLIC void *simjson_object_get(SimjsonObject *object, const char *key, size_t key_length) {
     if (object == NULL) {
         DEBUG_INFO("object is NULL");
@@ -175,81 +992,309 @@ SIMJSON_PUBLIC void *simjson_object_get(SimjsonObject *object, const char *key,
         return NULL;
     }
 
-    unsigned long hash = hash_func((unsigned char *) key, key_length);
-    size_t index = hash % (object->bucket_size - 1);
-    SimjsonObjectItem *item = object->buckets[index];
-
-    if (item != NULL) {
-        while (item) {
-            if (key_length == item->key_length && strncmp(item->key, key, key_length) == 0) {
-                return item->json_struct;
-            }
-            else {
-                item = item->next;
-            }
-        }
+    SimjsonObjectItem *item = object_find(object, key, key_length, NULL);
+    if (item == NULL) {
+//        DEBUG_INFO("key does not exists");
+        return NULL;
     }
+    return item->json_struct;
+}
 
-//    DEBUG_INFO("key does not exists");
-    return NULL;
+SIMJSON_PUBLIC SimjsonKey simjson_key_make(const char *key, size_t key_length) {
+    SimjsonKey handle = {key, key_length, 0};
+    if (key == NULL || key_length == 0) {
+        DEBUG_INFO("key is NULL or empty");
+        handle.key_length = 0;
+        return handle;
+    }
+    handle.hash = hash_func(key, key_length);
+    return handle;
 }
 
-SIMJSON_PUBLIC bool simjson_object_delete(SimjsonObject *object, const char *key, size_t key_length) {
+SIMJSON_PUBLIC void *simjson_object_get_k(SimjsonObject *object, const SimjsonKey *key) {
     if (object == NULL) {
         DEBUG_INFO("object is NULL");
-        return false;
+        return NULL;
     }
 
-    if (key == NULL || key_length == 0) {
+    if (key == NULL || key->key == NULL || key->key_length == 0) {
         DEBUG_INFO("key is NULL or empty");
+        return NULL;
+    }
+
+    SimjsonObjectItem *item = object_find(object, key->key, key->key_length, &key->hash);
+    if (item == NULL) {
+        return NULL;
+    }
+    return item->json_struct;
+}
+
+SIMJSON_PUBLIC bool simjson_object_delete(SimjsonObject *object, const char *key, size_t key_length) {
+    return object_remove(object, key, key_length, NULL, true);
+}
+
+SIMJSON_PUBLIC bool simjson_object_set(SimjsonObject *object, const char *key, size_t key_length, void *json_struct,
+                                       void **old_json_struct) {
+    if (old_json_struct != NULL) {
+        *old_json_struct = NULL;
+    }
+
+    if (json_struct == NULL) {
+        DEBUG_INFO("json_struct is NULL");
         return false;
     }
 
-    unsigned long hash = hash_func((unsigned char *) key, key_length);
-    size_t index = hash % (object->bucket_size - 1);
-    SimjsonObjectItem *cur_item = object->buckets[index];
-    SimjsonObjectItem *prev_item = NULL;
+    SimjsonObjectItem *item;
+    bool inserted;
+    if (!object_find_or_insert(object, key, key_length, json_struct, false, &item, &inserted)) {
+        return false;
+    }
+    if (inserted || item->json_struct == json_struct) {
+        return true;
+    }
 
-    if (cur_item != NULL) {
-        while (cur_item) {
-            if (key_length == cur_item->key_length && strncmp(cur_item->key, key, key_length) == 0) {
-                if (prev_item != NULL) {
-                    prev_item->next = cur_item->next;
-                }
-                else {
-                    object->buckets[index] = cur_item->next;
+    //原位替换，键保留
+    void *old = item->json_struct;
+    item->json_struct = json_struct;
+    simjson_encode_cache_attach(object, json_struct);
+    object_value_detach(old);
+    if (old_json_struct != NULL) {
+        *old_json_struct = old;
+    }
+    else {
+        simjson_free_json_struct(old);
+    }
+
+    return true;
+}
+
+SIMJSON_PUBLIC void *simjson_object_take(SimjsonObject *object, const char *key, size_t key_length) {
+    void *json_struct;
+    if (!object_remove(object, key, key_length, &json_struct, false)) {
+        return NULL;
+    }
+    return json_struct;
+}
+
+SIMJSON_PUBLIC void **simjson_object_get_or_insert_slot(SimjsonObject *object, const char *key, size_t key_length,
+                                                        void *json_struct, bool *inserted) {
+    SimjsonObjectItem *item;
+    bool item_inserted;
+    if (!object_find_or_insert(object, key, key_length, json_struct, false, &item, &item_inserted)) {
+        return NULL;
+    }
+    if (inserted != NULL) {
+        *inserted = item_inserted;
+    }
+    return &item->json_struct;
+}
+
+SIMJSON_PUBLIC bool simjson_object_slot_commit(SimjsonObject *object, void **slot) {
+    if (object == NULL || slot == NULL) {
+        DEBUG_INFO("object or slot is NULL");
+        return false;
+    }
+
+    SimjsonObjectItem *item = (SimjsonObjectItem *) ((char *) slot - offsetof(SimjsonObjectItem, json_struct));
+    if (item < object->items || item >= object->items + object->item_count) {
+        DEBUG_INFO("slot does not belong to object");
+        return false;
+    }
+
+    //未写入值时撤销插入，键值对留下的空位与删除相同
+    if (*slot == NULL) {
+        void *json_struct;
+        return object_remove(object, object_item_key(item), item->key_length, &json_struct, true);
+    }
+
+    simjson_encode_cache_attach(object, *slot);
+    return true;
+}
+
+//object移入target前要去掉其中的null，冻结的object中有null成员时无法去掉
+SIMJSON_PRIVATE bool merge_can_strip_nulls(const SimjsonObject *object) {
+    for (size_t i = 0; i < object->item_count; i++) {
+        void *value = object->items[i].json_struct;
+        if (SIMJSON_IS_NULL_TYPE(value) && object->frozen != NULL) {
+            DEBUG_INFO("object is frozen");
+            return false;
+        }
+        if (SIMJSON_IS_OBJECT_TYPE(value) && !merge_can_strip_nulls(value)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//与merge_object走相同的路径，只检查不修改，任何一处无法应用时整个合并在修改前失败
+SIMJSON_PRIVATE bool merge_can_apply(const SimjsonObject *target, const SimjsonObject *patch) {
+    if (target->frozen != NULL) {
+        DEBUG_INFO("object is frozen");
+        return false;
+    }
+
+    for (size_t i = 0; i < patch->item_count; i++) {
+        SimjsonObjectItem *item = &patch->items[i];
+        void *value = item->json_struct;
+        if (!SIMJSON_IS_OBJECT_TYPE(value)) {
+            continue;
+        }
+        SimjsonObjectItem *target_item = object_find(target, object_item_key(item), item->key_length, NULL);
+        if (target_item != NULL && SIMJSON_IS_OBJECT_TYPE(target_item->json_struct)) {
+            if (!merge_can_apply(target_item->json_struct, value)) {
+                return false;
+            }
+        }
+        else if (!merge_can_strip_nulls(value)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//去掉object中值为null的成员，递归处理值为object的成员
+//调用前已由merge_can_strip_nulls确认冻结的object中没有null成员
+SIMJSON_PRIVATE void merge_strip_nulls(SimjsonObject *object) {
+    size_t item_size = object->item_size;
+    for (size_t i = 0; i < object->item_count; i++) {
+        SimjsonObjectItem *item = &object->items[i];
+        if (SIMJSON_IS_NULL_TYPE(item->json_struct)) {
+            object_item_release(item);
+            item->json_struct = NULL;
+            object->item_size--;
+        }
+        else if (SIMJSON_IS_OBJECT_TYPE(item->json_struct)) {
+            merge_strip_nulls(item->json_struct);
+        }
+    }
+    if (object->item_size == item_size) {
+        return;
+    }
+
+    //压缩留下的空位，不分配内存
+    if (object->ctrl != NULL) {
+        reindex(object, false);
+    }
+    else {
+        size_t item_count = 0;
+        for (size_t i = 0; i < object->item_count; i++) {
+            if (object->items[i].json_struct != NULL) {
+                object->items[item_count++] = object->items[i];
+            }
+        }
+        object->item_count = item_count;
+    }
+    simjson_encode_cache_invalidate(object);
+}
+
+//以patch中的键值对更新target，patch中的值直接移入target
+//移走的键值对在patch中变为空位，patch随后整体释放，期间不再查找patch
+SIMJSON_PRIVATE bool merge_object(SimjsonObject *target, SimjsonObject *patch) {
+    if (target->frozen != NULL) {
+        DEBUG_INFO("object is frozen");
+        return false;
+    }
+
+    for (size_t i = 0; i < patch->item_count; i++) {
+        SimjsonObjectItem *item = &patch->items[i];
+        void *value = item->json_struct;
+        if (value == NULL) {
+            continue;
+        }
+        const char *key = object_item_key(item);
+
+        if (SIMJSON_IS_NULL_TYPE(value)) {
+            object_remove(target, key, item->key_length, NULL, false);
+            continue;
+        }
+
+        SimjsonObjectItem *target_item;
+        bool inserted;
+        if (!object_find_or_insert(target, key, item->key_length, value, false, &target_item, &inserted)) {
+            return false;
+        }
+        if (!inserted) {
+            void *old = target_item->json_struct;
+            if (SIMJSON_IS_OBJECT_TYPE(value) && SIMJSON_IS_OBJECT_TYPE(old)) {
+                if (!merge_object(old, value)) {
+                    return false;
                 }
-                simjson_object_item_free(cur_item);
-                object->item_size--;
-                return true;
+                continue;
             }
-            else {
-                prev_item = cur_item;
-                cur_item = cur_item->next;
+            target_item->json_struct = value;
+            simjson_encode_cache_attach(target, value);
+            simjson_free_json_struct(old);
+        }
+
+        //值已归target，patch中只释放键
+        if (SIMJSON_IS_OBJECT_TYPE(value)) {
+            merge_strip_nulls(value);
+        }
+        object_item_release_key(item);
+        item->json_struct = NULL;
+        patch->item_size--;
+    }
+
+    return true;
+}
+
+SIMJSON_PUBLIC bool simjson_merge_patch(void **target, void *patch) {
+    if (target == NULL || patch == NULL) {
+        DEBUG_INFO("target or patch is NULL");
+        return false;
+    }
+
+    //patch不是object时整体替换，target不是object时视为空object
+    if (!SIMJSON_IS_OBJECT_TYPE(patch) || !SIMJSON_IS_OBJECT_TYPE(*target)) {
+        if (SIMJSON_IS_OBJECT_TYPE(patch)) {
+            if (!merge_can_strip_nulls(patch)) {
+                simjson_free_json_struct(patch);
+                return false;
             }
+            merge_strip_nulls(patch);
         }
+        if (*target != NULL) {
+            simjson_free_json_struct(*target);
+        }
+        *target = patch;
+        return true;
     }
 
-    DEBUG_INFO("key does not exists");
-    return false;
+    bool success = merge_can_apply(*target, patch) && merge_object(*target, patch);
+    simjson_free_json_struct(patch);
+    return success;
 }
 
-SIMJSON_PUBLIC SimjsonObjectIterator *simjson_object_iterator_new(SimjsonObject *object) {
+SIMJSON_PUBLIC bool simjson_object_iterator_init(SimjsonObjectIterator *iterator, SimjsonObject *object) {
+    if (iterator == NULL) {
+        DEBUG_INFO("iterator is NULL");
+        return false;
+    }
+
     if (object == NULL) {
         DEBUG_INFO("object is NULL");
-        return NULL;
+        return false;
     }
 
+    iterator->object = object;
+    iterator->cur_entry_index = 0;
+    iterator->cur_item_index = 0;
+    iterator->last_item = NULL;
+
+    return true;
+}
+
+SIMJSON_PUBLIC SimjsonObjectIterator *simjson_object_iterator_new(SimjsonObject *object) {
     SimjsonObjectIterator *iterator = malloc(sizeof(SimjsonObjectIterator));
     if (iterator == NULL) {
         DEBUG_INFO(strerror(errno));
         return NULL;
     }
 
-    iterator->object = object;
-    iterator->cur_bucket_index = 0;
-    iterator->cur_item_index = 0;
-    iterator->cur_item = NULL;
+    if (!simjson_object_iterator_init(iterator, object)) {
+        free(iterator);
+        return NULL;
+    }
 
     return iterator;
 }
@@ -271,22 +1316,36 @@ SIMJSON_PUBLIC void *simjson_object_iterator_next(SimjsonObjectIterator *iterato
         return NULL;
     }
 
-    SimjsonObjectItem *cur_item = iterator->cur_item;
+    //按插入顺序线性扫描items，只需跳过已删除的空位
+    //cur_entry_index不会越界，因为检查了simjson_object_iterator_has_next
+    //除非在迭代过程中修改object
     SimjsonObject *object = iterator->object;
-    while (cur_item == NULL) {
-        //cur_bucket_index应该不会越界，因为检查了simjson_object_iterator_has_next
-        //除非在迭代过程中删除键值对
-        iterator->cur_bucket_index++;
-        cur_item = object->buckets[iterator->cur_bucket_index];
+    while (object->items[iterator->cur_entry_index].json_struct == NULL) {
+        iterator->cur_entry_index++;
     }
-    iterator->cur_item = cur_item->next;
+    SimjsonObjectItem *cur_item = &object->items[iterator->cur_entry_index];
+    iterator->cur_entry_index++;
+    iterator->last_item = cur_item;
     iterator->cur_item_index++;
 
     if (key != NULL) {
-        *key = cur_item->key;
+        *key = object_item_key(cur_item);
     }
     if (key_length != NULL) {
         *key_length = cur_item->key_length;
     }
     return cur_item->json_struct;
 }
+
+SIMJSON_PUBLIC const char *simjson_object_iterator_key_fragment(const SimjsonObjectIterator *iterator,
+                                                                size_t *length) {
+    if (iterator == NULL || iterator->last_item == NULL) {
+        DEBUG_INFO("no current item");
+        return NULL;
+    }
+
+    if (length != NULL) {
+        *length = iterator->last_item->key_fragment_length;
+    }
+    return object_item_fragment(iterator->last_item);
+}
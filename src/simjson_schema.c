@@ -0,0 +1,95 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "simjson_schema.h"
+
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ */
+
+SIMJSON_PRIVATE void schema_value_free(uint8_t type, const SimjsonSchema *schema, void *value) {
+    if (type == SIMJSON_FIELD_STRING) {
+        free(*(char **) value);
+        *(char **) value = NULL;
+    }
+    else if (type == SIMJSON_FIELD_OBJECT) {
+        simjson_schema_free(schema, value);
+    }
+}
+
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ */
+
+SIMJSON_PUBLIC size_t simjson_schema_element_size(uint8_t element_type, const SimjsonSchema *schema) {
+    switch (element_type) {
+        case SIMJSON_FIELD_INT64:
+            return sizeof(int64_t);
+        case SIMJSON_FIELD_INT32:
+            return sizeof(int32_t);
+        case SIMJSON_FIELD_DOUBLE:
+            return sizeof(double);
+        case SIMJSON_FIELD_BOOLEAN:
+            return sizeof(bool);
+        case SIMJSON_FIELD_STRING:
+            return sizeof(char *);
+        case SIMJSON_FIELD_OBJECT:
+            return schema == NULL ? 0 : schema->struct_size;
+        default:
+            return 0;
+    }
+}
+
+SIMJSON_PRIVATE void schema_field_free(const SimjsonField *field, void *struct_ptr) {
+    char *value = (char *) struct_ptr + field->offset;
+
+    if (field->type != SIMJSON_FIELD_ARRAY) {
+        schema_value_free(field->type, field->schema, value);
+        return;
+    }
+
+    char *elements = *(char **) value;
+    size_t *count = (size_t *) ((char *) struct_ptr + field->count_offset);
+    if (elements != NULL) {
+        if (field->element_type == SIMJSON_FIELD_STRING || field->element_type == SIMJSON_FIELD_OBJECT) {
+            size_t element_size = simjson_schema_element_size(field->element_type, field->schema);
+            for (size_t j = 0; j < *count; j++) {
+                schema_value_free(field->element_type, field->schema, elements + j * element_size);
+            }
+        }
+        free(elements);
+    }
+    *(char **) value = NULL;
+    *count = 0;
+}
+
+SIMJSON_PUBLIC void simjson_schema_free(const SimjsonSchema *schema, void *struct_ptr) {
+    if (schema == NULL || struct_ptr == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < schema->field_count; i++) {
+        schema_field_free(&schema->fields[i], struct_ptr);
+    }
+}
+
+SIMJSON_PUBLIC void simjson_schema_field_reset(const SimjsonField *field, void *struct_ptr) {
+    if (field == NULL || struct_ptr == NULL) {
+        return;
+    }
+
+    schema_field_free(field, struct_ptr);
+
+    size_t size;
+    if (field->type == SIMJSON_FIELD_CHARS) {
+        size = field->size;
+    }
+    else if (field->type == SIMJSON_FIELD_ARRAY) {
+        size = sizeof(char *);
+    }
+    else {
+        size = simjson_schema_element_size(field->type, field->schema);
+    }
+    memset((char *) struct_ptr + field->offset, 0, size);
+}
@@ -24,7 +24,7 @@ SIMJSON_PUBLIC SimjsonString *simjson_string_new(const char *value, size_t lengt
         return NULL;
     }
 
-    string->value = malloc(sizeof(length + 1));
+    string->value = malloc(length + 1);
     if (string->value == NULL) {
         DEBUG_INFO(strerror(errno));
         free(string);
@@ -34,6 +34,27 @@ SIMJSON_PUBLIC SimjsonString *simjson_string_new(const char *value, size_t lengt
     memcpy(string->value, value, length);
     string->value[length] = '\0';
     string->length = length;
+    string->borrowed = false;
+    string->type = SIMJSON_STRING_TYPE;
+
+    return string;
+}
+
+SIMJSON_PUBLIC SimjsonString *simjson_string_new_borrowed(char *value, size_t length) {
+    if (value == NULL) {
+        DEBUG_INFO("value is NULL");
+        return NULL;
+    }
+
+    SimjsonString *string = malloc(sizeof(SimjsonString));
+    if (string == NULL) {
+        DEBUG_INFO(strerror(errno));
+        return NULL;
+    }
+
+    string->value = value;
+    string->length = length;
+    string->borrowed = true;
     string->type = SIMJSON_STRING_TYPE;
 
     return string;
@@ -41,7 +62,9 @@ SIMJSON_PUBLIC SimjsonString *simjson_string_new(const char *value, size_t lengt
 
 SIMJSON_PUBLIC void simjson_string_free(SimjsonString *string) {
     if (string != NULL) {
-        free(string->value);
+        if (!string->borrowed) {
+            free(string->value);
+        }
         free(string);
     }
 }
\ No newline at end of file
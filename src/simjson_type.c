@@ -1,3 +1,5 @@
+#include <stdlib.h>
+
 #include "simjson.h"
 
 SIMJSON_PUBLIC void simjson_free_json_struct(void *json_struct) {
@@ -22,4 +24,82 @@ SIMJSON_PUBLIC void simjson_free_json_struct(void *json_struct) {
     else if (SIMJSON_IS_OBJECT_TYPE(json_struct)) {
         simjson_object_free(json_struct);
     }
-}
\ No newline at end of file
+}
+
+SIMJSON_PUBLIC SimjsonEncodeCache *simjson_encode_cache_of(void *json_struct) {
+    if (SIMJSON_IS_ARRAY_TYPE(json_struct)) {
+        return &((SimjsonArray *) json_struct)->cache;
+    }
+    else if (SIMJSON_IS_OBJECT_TYPE(json_struct)) {
+        return &((SimjsonObject *) json_struct)->cache;
+    }
+    return NULL;
+}
+
+//对json_struct及其所有子容器设置enabled
+SIMJSON_PRIVATE void set_cache_enabled(void *json_struct, bool enabled) {
+    SimjsonEncodeCache *cache = simjson_encode_cache_of(json_struct);
+    if (cache == NULL) {
+        return;
+    }
+
+    cache->enabled = enabled;
+    if (!enabled) {
+        simjson_encode_cache_release(cache);
+    }
+
+    if (SIMJSON_IS_ARRAY_TYPE(json_struct)) {
+        SimjsonArrayIterator iterator;
+        if (simjson_array_iterator_init(&iterator, json_struct, 0)) {
+            while (simjson_array_iterator_has_next(&iterator)) {
+                set_cache_enabled(simjson_array_iterator_next(&iterator, NULL), enabled);
+            }
+        }
+    }
+    else {
+        SimjsonObjectIterator iterator;
+        if (simjson_object_iterator_init(&iterator, json_struct)) {
+            while (simjson_object_iterator_has_next(&iterator)) {
+                set_cache_enabled(simjson_object_iterator_next(&iterator, NULL, NULL), enabled);
+            }
+        }
+    }
+}
+
+SIMJSON_PUBLIC void simjson_encode_cache_enable(void *json_struct) {
+    set_cache_enabled(json_struct, true);
+}
+
+SIMJSON_PUBLIC void simjson_encode_cache_disable(void *json_struct) {
+    //祖先的缓存可能引用子树中的缓存
+    simjson_encode_cache_invalidate(json_struct);
+    set_cache_enabled(json_struct, false);
+}
+
+SIMJSON_PUBLIC void simjson_encode_cache_invalidate(void *json_struct) {
+    //容器只在所有子孙容器都已缓存时才保存缓存，因此未缓存的容器之上不会有已缓存的祖先
+    SimjsonEncodeCache *cache = simjson_encode_cache_of(json_struct);
+    while (cache != NULL && cache->encoded != NULL) {
+        simjson_encode_cache_release(cache);
+        cache = simjson_encode_cache_of(cache->parent);
+    }
+}
+
+SIMJSON_PUBLIC void simjson_encode_cache_release(SimjsonEncodeCache *cache) {
+    free(cache->encoded);
+    free(cache->refs);
+    cache->encoded = NULL;
+    cache->refs = NULL;
+    cache->ref_count = 0;
+}
+
+SIMJSON_PUBLIC void simjson_encode_cache_attach(void *container, void *child) {
+    SimjsonEncodeCache *child_cache = simjson_encode_cache_of(child);
+    if (child_cache != NULL) {
+        child_cache->parent = container;
+        if (simjson_encode_cache_of(container)->enabled) {
+            simjson_encode_cache_enable(child);
+        }
+    }
+    simjson_encode_cache_invalidate(container);
+}
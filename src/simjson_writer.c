@@ -0,0 +1,273 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include "simjson_writer.h"
+#include "json_buf.h"
+#include "log.h"
+
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ */
+
+const static size_t WRITER_INITIAL_SIZE = 256;
+const static size_t WRITER_DEFAULT_SINK_SIZE = 64 * 1024;
+
+//嵌套栈中每层的状态
+#define LEVEL_IN_OBJECT 0x1
+#define LEVEL_HAS_ITEMS 0x2
+#define LEVEL_AFTER_KEY 0x4
+
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ */
+
+struct SimjsonWriter {
+    JsonBuf *json_buf;
+    //levels[0]为顶层，只允许写入一个值
+    uint8_t levels[SIMJSON_WRITER_MAX_DEPTH + 1];
+    size_t depth;
+    bool failed;
+};
+
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ */
+
+SIMJSON_PRIVATE bool writer_fail(SimjsonWriter *writer, const char *debug_msg) {
+    DEBUG_INFO(debug_msg);
+    writer->failed = true;
+    return false;
+}
+
+SIMJSON_PRIVATE inline bool writer_append(SimjsonWriter *writer, const char *str, size_t length) {
+    if (!json_buf_append(writer->json_buf, str, length)) {
+        writer->failed = true;
+        return false;
+    }
+    return true;
+}
+
+//写入值之前的检查与分隔符
+SIMJSON_PRIVATE bool writer_before_value(SimjsonWriter *writer) {
+    if (writer == NULL) {
+        DEBUG_INFO("writer is NULL");
+        return false;
+    }
+    if (writer->failed) {
+        return false;
+    }
+
+    uint8_t *level = &writer->levels[writer->depth];
+    if (writer->depth == 0) {
+        if (*level & LEVEL_HAS_ITEMS) {
+            return writer_fail(writer, "only one top-level value is allowed");
+        }
+    }
+    else if (*level & LEVEL_IN_OBJECT) {
+        if (!(*level & LEVEL_AFTER_KEY)) {
+            return writer_fail(writer, "object value without key");
+        }
+        *level &= ~LEVEL_AFTER_KEY;
+    }
+    else if ((*level & LEVEL_HAS_ITEMS) && !writer_append(writer, ", ", 2)) {
+        return false;
+    }
+
+    *level |= LEVEL_HAS_ITEMS;
+    return true;
+}
+
+SIMJSON_PRIVATE bool writer_begin(SimjsonWriter *writer, uint8_t level, const char *bracket) {
+    if (!writer_before_value(writer)) {
+        return false;
+    }
+    if (writer->depth == SIMJSON_WRITER_MAX_DEPTH) {
+        return writer_fail(writer, "nesting too deep");
+    }
+    writer->levels[++writer->depth] = level;
+    return writer_append(writer, bracket, 1);
+}
+
+SIMJSON_PRIVATE bool writer_end(SimjsonWriter *writer, bool in_object, const char *bracket) {
+    if (writer == NULL) {
+        DEBUG_INFO("writer is NULL");
+        return false;
+    }
+    if (writer->failed) {
+        return false;
+    }
+
+    uint8_t level = writer->levels[writer->depth];
+    if (writer->depth == 0 || ((level & LEVEL_IN_OBJECT) != 0) != in_object || (level & LEVEL_AFTER_KEY)) {
+        return writer_fail(writer, "mismatched end of container");
+    }
+    writer->depth--;
+    return writer_append(writer, bracket, 1);
+}
+
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ */
+
+SIMJSON_PUBLIC SimjsonWriter *simjson_writer_new(SimjsonSink sink, void *sink_ctx, size_t buf_size) {
+    SimjsonWriter *writer = malloc(sizeof(SimjsonWriter));
+    if (writer == NULL) {
+        DEBUG_INFO(strerror(errno));
+        return NULL;
+    }
+
+    if (buf_size == 0) {
+        buf_size = sink == NULL ? WRITER_INITIAL_SIZE : WRITER_DEFAULT_SINK_SIZE;
+    }
+    writer->json_buf = json_buf_new(buf_size, sink, sink_ctx);
+    if (writer->json_buf == NULL) {
+        free(writer);
+        return NULL;
+    }
+
+    writer->levels[0] = 0;
+    writer->depth = 0;
+    writer->failed = false;
+
+    return writer;
+}
+
+SIMJSON_PUBLIC void simjson_writer_free(SimjsonWriter *writer) {
+    if (writer != NULL) {
+        json_buf_free(writer->json_buf);
+        free(writer);
+    }
+}
+
+SIMJSON_PUBLIC bool simjson_writer_begin_object(SimjsonWriter *writer) {
+    return writer_begin(writer, LEVEL_IN_OBJECT, "{");
+}
+
+SIMJSON_PUBLIC bool simjson_writer_end_object(SimjsonWriter *writer) {
+    return writer_end(writer, true, "}");
+}
+
+SIMJSON_PUBLIC bool simjson_writer_begin_array(SimjsonWriter *writer) {
+    return writer_begin(writer, 0, "[");
+}
+
+SIMJSON_PUBLIC bool simjson_writer_end_array(SimjsonWriter *writer) {
+    return writer_end(writer, false, "]");
+}
+
+SIMJSON_PUBLIC bool simjson_writer_key(SimjsonWriter *writer, const char *key, size_t key_length) {
+    if (writer == NULL || key == NULL) {
+        DEBUG_INFO("writer or key is NULL");
+        return false;
+    }
+    if (writer->failed) {
+        return false;
+    }
+
+    uint8_t *level = &writer->levels[writer->depth];
+    if (!(*level & LEVEL_IN_OBJECT) || (*level & LEVEL_AFTER_KEY)) {
+        return writer_fail(writer, "key outside object or missing value");
+    }
+    if ((*level & LEVEL_HAS_ITEMS) && !writer_append(writer, ", ", 2)) {
+        return false;
+    }
+    *level |= LEVEL_HAS_ITEMS | LEVEL_AFTER_KEY;
+
+    if (!writer_append(writer, "\"", 1) || !json_buf_append_escaped(writer->json_buf, key, key_length)) {
+        writer->failed = true;
+        return false;
+    }
+    return writer_append(writer, "\": ", 3);
+}
+
+SIMJSON_PUBLIC bool simjson_writer_string(SimjsonWriter *writer, const char *value, size_t length) {
+    if (value == NULL) {
+        return simjson_writer_null(writer);
+    }
+    if (!writer_before_value(writer)) {
+        return false;
+    }
+    if (!writer_append(writer, "\"", 1) || !json_buf_append_escaped(writer->json_buf, value, length)) {
+        writer->failed = true;
+        return false;
+    }
+    return writer_append(writer, "\"", 1);
+}
+
+SIMJSON_PUBLIC bool simjson_writer_integer(SimjsonWriter *writer, int64_t value) {
+    if (!writer_before_value(writer)) {
+        return false;
+    }
+    if (!json_buf_append_integer(writer->json_buf, value)) {
+        writer->failed = true;
+        return false;
+    }
+    return true;
+}
+
+SIMJSON_PUBLIC bool simjson_writer_double(SimjsonWriter *writer, double value) {
+    if (!writer_before_value(writer)) {
+        return false;
+    }
+    if (!json_buf_append_double(writer->json_buf, value)) {
+        writer->failed = true;
+        return false;
+    }
+    return true;
+}
+
+SIMJSON_PUBLIC bool simjson_writer_boolean(SimjsonWriter *writer, bool value) {
+    if (!writer_before_value(writer)) {
+        return false;
+    }
+    return value ? writer_append(writer, "true", 4) : writer_append(writer, "false", 5);
+}
+
+SIMJSON_PUBLIC bool simjson_writer_null(SimjsonWriter *writer) {
+    if (!writer_before_value(writer)) {
+        return false;
+    }
+    return writer_append(writer, "null", 4);
+}
+
+SIMJSON_PUBLIC bool simjson_writer_finish(SimjsonWriter *writer) {
+    if (writer == NULL) {
+        DEBUG_INFO("writer is NULL");
+        return false;
+    }
+    if (writer->failed) {
+        return false;
+    }
+    if (writer->depth != 0 || !(writer->levels[0] & LEVEL_HAS_ITEMS)) {
+        return writer_fail(writer, "json is incomplete");
+    }
+    if (!json_buf_flush(writer->json_buf)) {
+        writer->failed = true;
+        return false;
+    }
+    return true;
+}
+
+SIMJSON_PUBLIC const char *simjson_writer_data(SimjsonWriter *writer, size_t *length) {
+    if (writer == NULL) {
+        DEBUG_INFO("writer is NULL");
+        return NULL;
+    }
+    if (writer->json_buf->sink != NULL) {
+        DEBUG_INFO("writer outputs to sink");
+        return NULL;
+    }
+
+    JsonBuf *json_buf = writer->json_buf;
+    if (!json_buf_has_space_for(json_buf, 1) && !json_buf_grow(json_buf, 1)) {
+        return NULL;
+    }
+    json_buf->buf[json_buf->length] = '\0';
+
+    if (length != NULL) {
+        *length = json_buf->length;
+    }
+    return json_buf->buf;
+}
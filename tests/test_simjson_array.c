@@ -197,6 +197,29 @@ void test_simjson_array_iterator_with_invalid_arg() {
     simjson_array_free(array);
 }
 
+void test_simjson_array_iterator_init() {
+    SimjsonArray *array = simjson_array_new();
+    simjson_array_insert(array, simjson_string_new("0", 1), array->size);
+    simjson_array_insert(array, simjson_boolean_new(true), array->size);
+
+    SimjsonArrayIterator iterator;
+    TEST_ASSERT_TRUE(simjson_array_iterator_init(&iterator, array, 1));
+    TEST_ASSERT_EQUAL_UINT64(1, iterator.cur_index);
+
+    size_t index;
+    TEST_ASSERT_TRUE(simjson_array_iterator_has_next(&iterator));
+    void *json_struct = simjson_array_iterator_next(&iterator, &index);
+    TEST_ASSERT_TRUE(SIMJSON_IS_BOOLEAN_TYPE(json_struct));
+    TEST_ASSERT_EQUAL_UINT64(1, index);
+    TEST_ASSERT_FALSE(simjson_array_iterator_has_next(&iterator));
+
+    TEST_ASSERT_FALSE(simjson_array_iterator_init(NULL, array, 0));
+    TEST_ASSERT_FALSE(simjson_array_iterator_init(&iterator, NULL, 0));
+    TEST_ASSERT_FALSE(simjson_array_iterator_init(&iterator, array, array->size));
+
+    simjson_array_free(array);
+}
+
 int main() {
     UNITY_BEGIN();
 
@@ -206,6 +229,7 @@ int main() {
     RUN_TEST(test_simjson_array_crud_with_invalid_index);
     RUN_TEST(test_simjson_array_iterator);
     RUN_TEST(test_simjson_array_iterator_with_invalid_arg);
+    RUN_TEST(test_simjson_array_iterator_init);
 
-    UNITY_END();
+    return UNITY_END();
 }
\ No newline at end of file
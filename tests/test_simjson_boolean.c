@@ -17,6 +17,6 @@ void test_simjson_boolean_new() {
 int main() {
     UNITY_BEGIN();
     RUN_TEST(test_simjson_boolean_new);
-    UNITY_END();
+    return UNITY_END();
 }
 
@@ -1,4 +1,5 @@
 #include <stdlib.h>
+#include <stdio.h>
 
 #include "unity.h"
 #include "simjson.h"
@@ -33,6 +34,43 @@ void test_simjson_decode_encode_string() {
     test_json_decode_encode("    \"C Programming Language\"      ", "\"C Programming Language\"");
 }
 
+void test_simjson_decode_string_unescape() {
+    char *json_str = "\"line\\nbreak \\u00e9 \\ud83d\\ude00 \\/\"";
+    void *json_struct = simjson_decode(json_str, strlen(json_str));
+    test_string(json_struct, "line\nbreak \xc3\xa9 \xf0\x9f\x98\x80 /", 20);
+    simjson_free_json_struct(json_struct);
+
+    test_json_decode_encode("\"tab\\there\\u0001\"", "\"tab\\there\\u0001\"");
+
+    json_str = "\"bad \\u12g4\"";
+    TEST_ASSERT_NULL(simjson_decode(json_str, strlen(json_str)));
+}
+
+void test_simjson_decode_insitu() {
+    char json_str[] = "{\"na\\\"me\": \"Ja\\nck\", \"tags\": [\"a\", \"b\\tc\"]}";
+    void *json_struct = simjson_decode_insitu(json_str, strlen(json_str));
+    TEST_ASSERT_TRUE(SIMJSON_IS_OBJECT_TYPE(json_struct));
+
+    SimjsonString *name = simjson_object_get(json_struct, "na\"me", 5);
+    test_string(name, "Ja\nck", 5);
+    TEST_ASSERT_TRUE(name->borrowed);
+    TEST_ASSERT_TRUE(name->value > json_str && name->value < json_str + sizeof(json_str));
+
+    SimjsonArray *tags = simjson_object_get(json_struct, "tags", 4);
+    TEST_ASSERT_NOT_NULL(tags);
+    test_string(simjson_array_get(tags, 1), "b\tc", 3);
+
+    size_t length;
+    char *encoded = simjson_encode(json_struct, &length);
+    TEST_ASSERT_NOT_NULL(encoded);
+    free(encoded);
+
+    simjson_free_json_struct(json_struct);
+
+    char bad_str[] = "[\"a\", ]";
+    TEST_ASSERT_NULL(simjson_decode_insitu(bad_str, strlen(bad_str)));
+}
+
 void test_simjson_decode_string_with_syntax_error() {
     char *json_str = " \"Hello  ";
     TEST_ASSERT_NULL(simjson_decode(json_str, strlen(json_str)));
@@ -78,6 +116,13 @@ void test_simjson_decode_boolean_with_syntax_error() {
 
     json_str = "fall";
     TEST_ASSERT_NULL(simjson_decode(json_str, strlen(json_str)));
+
+    //字面量比较不能越过length
+    json_str = "true";
+    TEST_ASSERT_NULL(simjson_decode(json_str, 3));
+
+    json_str = "false";
+    TEST_ASSERT_NULL(simjson_decode(json_str, 4));
 }
 
 void test_simjson_decode_encode_null() {
@@ -88,6 +133,9 @@ void test_simjson_decode_encode_null() {
 void test_simjson_decode_null_with_syntax_error() {
     char *json_str = "nul";
     TEST_ASSERT_NULL(simjson_decode(json_str, strlen(json_str)));
+
+    json_str = "null";
+    TEST_ASSERT_NULL(simjson_decode(json_str, 3));
 }
 
 void test_simjson_decode_encode_array() {
@@ -118,6 +166,10 @@ void test_simjson_decode_array_with_syntax_error() {
 
     json_str = "1,2]";
     TEST_ASSERT_NULL(simjson_decode(json_str, strlen(json_str)));
+
+    //分隔符检查不能越过length
+    json_str = "[1,2]";
+    TEST_ASSERT_NULL(simjson_decode(json_str, 2));
 }
 
 void test_simjson_decode_encode_object() {
@@ -175,6 +227,15 @@ void test_simjson_decode_encode_object() {
     simjson_object_free(object);
 }
 
+void test_simjson_decode_encode_object_order() {
+    //键按原始顺序输出，超过小object阈值时同样如此
+    test_json_decode_encode("{\"z\": 1, \"a\": 2, \"m\": 3}", "{\"z\": 1, \"a\": 2, \"m\": 3}");
+    test_json_decode_encode("{\"k9\": 9, \"k8\": 8, \"k7\": 7, \"k6\": 6, \"k5\": 5, \"k4\": 4, \"k3\": 3, "
+                            "\"k2\": 2, \"k1\": 1, \"k0\": 0}",
+                            "{\"k9\": 9, \"k8\": 8, \"k7\": 7, \"k6\": 6, \"k5\": 5, \"k4\": 4, \"k3\": 3, "
+                            "\"k2\": 2, \"k1\": 1, \"k0\": 0}");
+}
+
 void test_simjson_decode_object_with_syntax_error() {
     char *json_str = "{\"name\" :}";
     TEST_ASSERT_NULL(simjson_decode(json_str, strlen(json_str)));
@@ -205,6 +266,508 @@ void test_simjson_decode_object_with_syntax_error() {
 
     json_str = "{123: \"Jack\"}";
     TEST_ASSERT_NULL(simjson_decode(json_str, strlen(json_str)));
+
+    //分隔符检查不能越过length
+    json_str = "{\"a\":1,\"b\":2}";
+    TEST_ASSERT_NULL(simjson_decode(json_str, 4));
+    TEST_ASSERT_NULL(simjson_decode(json_str, 7));
+}
+
+void test_simjson_encode_escape_long_string() {
+    //特殊字符分布在16字节块边界两侧
+    char value[48];
+    memset(value, 'a', sizeof(value));
+    value[0] = '\"';
+    value[15] = '\\';
+    value[16] = '\n';
+    value[31] = 0x01;
+    value[47] = 0x1F;
+
+    char expected[128];
+    size_t length = 0;
+    expected[length++] = '\"';
+    for (size_t i = 0; i < sizeof(value); i++) {
+        switch (value[i]) {
+            case '\"':
+                length += sprintf(expected + length, "\\\"");
+                break;
+            case '\\':
+                length += sprintf(expected + length, "\\\\");
+                break;
+            case '\n':
+                length += sprintf(expected + length, "\\n");
+                break;
+            case 'a':
+                expected[length++] = 'a';
+                break;
+            default:
+                length += sprintf(expected + length, "\\u%04x", value[i]);
+                break;
+        }
+    }
+    expected[length++] = '\"';
+    expected[length] = '\0';
+
+    SimjsonString *string = simjson_string_new(value, sizeof(value));
+    size_t encoded_length;
+    char *encoded = simjson_encode(string, &encoded_length);
+    TEST_ASSERT_EQUAL_STRING(expected, encoded);
+    TEST_ASSERT_EQUAL_UINT64(length, encoded_length);
+
+    //编码结果能解码回原字符串
+    SimjsonString *decoded = simjson_decode(encoded, encoded_length);
+    TEST_ASSERT_NOT_NULL(decoded);
+    TEST_ASSERT_EQUAL_UINT64(sizeof(value), decoded->length);
+    TEST_ASSERT_EQUAL_MEMORY(value, decoded->value, sizeof(value));
+
+    free(encoded);
+    simjson_string_free(decoded);
+    simjson_string_free(string);
+}
+
+void test_simjson_encoded_size() {
+    char *json_str = "{\"na\\\"me\": \"Ja\\n\\u0001ck\", \"info\": [-9223372036854775808, 0, -7, 65.5, 1e+100],"
+                     " \"ok\": [true, false, null, {}, []]}";
+    void *json_struct = simjson_decode(json_str, strlen(json_str));
+    TEST_ASSERT_NOT_NULL(json_struct);
+
+    size_t length;
+    char *encoded = simjson_encode(json_struct, &length);
+    TEST_ASSERT_EQUAL_STRING(json_str, encoded);
+    TEST_ASSERT_EQUAL_UINT64(strlen(json_str), length);
+    TEST_ASSERT_EQUAL_UINT64(length, simjson_encoded_size(json_struct));
+    free(encoded);
+
+    simjson_free_json_struct(json_struct);
+    TEST_ASSERT_EQUAL_UINT64(0, simjson_encoded_size(NULL));
+}
+
+void test_simjson_encode_into() {
+    char *json_str = "[\"Jack\", true, [123, 3.14], null]";
+    void *json_struct = simjson_decode(json_str, strlen(json_str));
+
+    size_t needed;
+    TEST_ASSERT_FALSE(simjson_encode_into(json_struct, NULL, 0, &needed));
+    TEST_ASSERT_EQUAL_UINT64(strlen(json_str), needed);
+
+    char small[8];
+    TEST_ASSERT_FALSE(simjson_encode_into(json_struct, small, sizeof(small), &needed));
+    TEST_ASSERT_EQUAL_UINT64(strlen(json_str), needed);
+
+    char exact[needed + 1];
+    TEST_ASSERT_TRUE(simjson_encode_into(json_struct, exact, sizeof(exact), &needed));
+    TEST_ASSERT_EQUAL_STRING(json_str, exact);
+
+    //没有'\0'的空间也视为不足
+    TEST_ASSERT_FALSE(simjson_encode_into(json_struct, exact, needed, NULL));
+
+    simjson_free_json_struct(json_struct);
+}
+
+typedef struct {
+    char buf[256];
+    size_t length;
+    size_t calls;
+} SinkBuf;
+
+static bool sink_buf_write(void *ctx, const char *data, size_t length) {
+    SinkBuf *sink_buf = (SinkBuf *) ctx;
+    if (sink_buf->length + length >= sizeof(sink_buf->buf)) {
+        return false;
+    }
+    memcpy(sink_buf->buf + sink_buf->length, data, length);
+    sink_buf->length += length;
+    sink_buf->buf[sink_buf->length] = '\0';
+    sink_buf->calls++;
+    return true;
+}
+
+static bool sink_fail(void *ctx, const char *data, size_t length) {
+    (void) ctx;
+    (void) data;
+    (void) length;
+    return false;
+}
+
+void test_simjson_encode_to_sink() {
+    char *json_str = "{\"name\": \"Jack\", \"info\": [170, 65.5, true, null]}";
+    void *json_struct = simjson_decode(json_str, strlen(json_str));
+
+    SinkBuf sink_buf = {{0}, 0, 0};
+    TEST_ASSERT_TRUE(simjson_encode_to_sink(json_struct, sink_buf_write, &sink_buf));
+    TEST_ASSERT_EQUAL_UINT64(strlen(json_str), sink_buf.length);
+    TEST_ASSERT_EQUAL_UINT64(1, sink_buf.calls);
+
+    TEST_ASSERT_FALSE(simjson_encode_to_sink(json_struct, sink_fail, NULL));
+    TEST_ASSERT_FALSE(simjson_encode_to_sink(json_struct, NULL, NULL));
+
+    simjson_free_json_struct(json_struct);
+}
+
+void test_simjson_encode_to_fd() {
+    SimjsonArray *array = simjson_array_new();
+    char value[1000];
+    memset(value, 'x', sizeof(value));
+    for (size_t i = 0; i < 100; i++) {
+        simjson_array_insert(array, simjson_string_new(value, sizeof(value)), array->size);
+    }
+    //超过缓冲区大小的字符串直接交给sink，须排在前面已写满的缓冲区之后
+    char *long_value = malloc(100 * 1024);
+    memset(long_value, 'y', 100 * 1024);
+    simjson_array_insert(array, simjson_string_new(long_value, 100 * 1024), 70);
+    free(long_value);
+
+    FILE *file = tmpfile();
+    TEST_ASSERT_NOT_NULL(file);
+    TEST_ASSERT_TRUE(simjson_encode_to_fd(array, fileno(file)));
+
+    size_t expected_length;
+    char *expected = simjson_encode(array, &expected_length);
+    TEST_ASSERT_TRUE(expected_length > 64 * 1024);
+
+    rewind(file);
+    char *written = malloc(expected_length + 1);
+    TEST_ASSERT_EQUAL_UINT64(expected_length, fread(written, 1, expected_length + 1, file));
+    TEST_ASSERT_EQUAL_MEMORY(expected, written, expected_length);
+
+    TEST_ASSERT_FALSE(simjson_encode_to_fd(array, -1));
+
+    free(written);
+    free(expected);
+    fclose(file);
+    simjson_array_free(array);
+}
+
+void test_simjson_encode_ex() {
+    char *json_str = "{\"name\": \"Jack\", \"info\": [1, {\"x\": null}, [], {}]}";
+    void *json_struct = simjson_decode(json_str, strlen(json_str));
+    TEST_ASSERT_NOT_NULL(json_struct);
+
+    size_t length;
+    char *encoded = simjson_encode_ex(json_struct, NULL, &length);
+    char *expected = simjson_encode(json_struct, NULL);
+    TEST_ASSERT_EQUAL_STRING(expected, encoded);
+    free(encoded);
+    free(expected);
+
+    //单键object不受哈希顺序影响
+    void *inner = simjson_object_get(json_struct, "info", 4);
+    SimjsonEncodeOptions compact = {SIMJSON_ENCODE_COMPACT, 0};
+    encoded = simjson_encode_ex(inner, &compact, &length);
+    TEST_ASSERT_EQUAL_STRING("[1,{\"x\":null},[],{}]", encoded);
+    TEST_ASSERT_EQUAL_UINT64(strlen(encoded), length);
+    free(encoded);
+
+    SimjsonEncodeOptions pretty = {SIMJSON_ENCODE_PRETTY, 2};
+    encoded = simjson_encode_ex(inner, &pretty, &length);
+    TEST_ASSERT_EQUAL_STRING("[\n  1,\n  {\n    \"x\": null\n  },\n  [],\n  {}\n]", encoded);
+    TEST_ASSERT_EQUAL_UINT64(strlen(encoded), length);
+    free(encoded);
+
+    SimjsonEncodeOptions unknown = {42, 0};
+    TEST_ASSERT_NULL(simjson_encode_ex(json_struct, &unknown, &length));
+
+    simjson_free_json_struct(json_struct);
+}
+
+void test_simjson_encode_canonical() {
+    //插入顺序不同，输出字节相同
+    char *json_str1 = "{\"b\": 1, \"ab\": [true, {\"z\": 1, \"y\": 2}], \"a\": \"x\", \"\\u00e9\": null}";
+    char *json_str2 = "{\"\\u00e9\": null, \"a\": \"x\", \"ab\": [true, {\"y\": 2, \"z\": 1}], \"b\": 1}";
+    void *json_struct1 = simjson_decode(json_str1, strlen(json_str1));
+    void *json_struct2 = simjson_decode(json_str2, strlen(json_str2));
+    TEST_ASSERT_NOT_NULL(json_struct1);
+    TEST_ASSERT_NOT_NULL(json_struct2);
+
+    SimjsonEncodeOptions canonical = {SIMJSON_ENCODE_CANONICAL, 0};
+    size_t length1, length2;
+    char *encoded1 = simjson_encode_ex(json_struct1, &canonical, &length1);
+    char *encoded2 = simjson_encode_ex(json_struct2, &canonical, &length2);
+    TEST_ASSERT_EQUAL_STRING("{\"a\":\"x\",\"ab\":[true,{\"y\":2,\"z\":1}],\"b\":1,\"\xc3\xa9\":null}", encoded1);
+    TEST_ASSERT_EQUAL_STRING(encoded1, encoded2);
+    TEST_ASSERT_EQUAL_UINT64(strlen(encoded1), length1);
+    TEST_ASSERT_EQUAL_UINT64(length1, length2);
+
+    free(encoded1);
+    free(encoded2);
+    simjson_free_json_struct(json_struct1);
+    simjson_free_json_struct(json_struct2);
+}
+
+void test_simjson_encode_parallel() {
+    SimjsonArray *array = simjson_array_new();
+    SimjsonObject *object = simjson_object_new(0);
+    char key[32];
+    for (int i = 0; i < 3000; i++) {
+        SimjsonObject *item = simjson_object_new(0);
+        int64_t id = i;
+        simjson_object_add(item, "id", 2, simjson_number_new(&id, NULL));
+        simjson_object_add(item, "tags", 4, simjson_array_new());
+        simjson_array_insert(array, item, array->size);
+
+        int key_length = snprintf(key, sizeof(key), "key%d", i);
+        simjson_object_add(object, key, key_length, simjson_string_new(key, key_length));
+    }
+
+    SimjsonEncodeOptions modes[] = {{SIMJSON_ENCODE_DEFAULT, 0}, {SIMJSON_ENCODE_COMPACT, 0},
+                                    {SIMJSON_ENCODE_PRETTY, 2}, {SIMJSON_ENCODE_CANONICAL, 0}};
+    //只有一个元素的外层容器逐层向内，拆分{"data": [[...]]}中的内层array
+    char *array_str = simjson_encode(array, NULL);
+    SimjsonArray *data = simjson_array_new();
+    simjson_array_insert(data, simjson_decode(array_str, strlen(array_str)), 0);
+    SimjsonObject *wrapped = simjson_object_new(0);
+    simjson_object_add(wrapped, "data", 4, data);
+    free(array_str);
+
+    void *roots[] = {array, object, wrapped};
+    size_t root_count = sizeof(roots) / sizeof(roots[0]);
+    size_t thread_counts[] = {0, 1, 4, 7};
+    char *expected[3][sizeof(modes) / sizeof(modes[0])];
+    size_t lengths[3][sizeof(modes) / sizeof(modes[0])];
+    for (size_t r = 0; r < root_count; r++) {
+        for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+            expected[r][m] = simjson_encode_ex(roots[r], &modes[m], &lengths[r][m]);
+            TEST_ASSERT_NOT_NULL(expected[r][m]);
+        }
+    }
+
+    //第二轮启用缓存，格式切换时各线程替换元素的缓存
+    for (int pass = 0; pass < 2; pass++) {
+        if (pass == 1) {
+            simjson_encode_cache_enable(array);
+            simjson_encode_cache_enable(object);
+            simjson_encode_cache_enable(wrapped);
+        }
+        for (size_t r = 0; r < root_count; r++) {
+            for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+                for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++) {
+                    size_t length;
+                    char *parallel = simjson_encode_parallel(roots[r], &modes[m], thread_counts[t], &length);
+                    TEST_ASSERT_NOT_NULL(parallel);
+                    TEST_ASSERT_EQUAL_UINT64(lengths[r][m], length);
+                    TEST_ASSERT_EQUAL_STRING(expected[r][m], parallel);
+                    free(parallel);
+                }
+            }
+        }
+    }
+    //并行编码同样保存路径上容器的缓存
+    for (size_t r = 0; r < root_count; r++) {
+        TEST_ASSERT_NOT_NULL(simjson_encode_cache_of(roots[r])->encoded);
+        for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+            free(expected[r][m]);
+        }
+    }
+
+    //元素过少时退化为单线程
+    char *json_str = "[1, 2, 3]";
+    void *small = simjson_decode(json_str, strlen(json_str));
+    char *encoded = simjson_encode_parallel(small, NULL, 8, NULL);
+    TEST_ASSERT_EQUAL_STRING(json_str, encoded);
+    free(encoded);
+
+    simjson_free_json_struct(small);
+    simjson_free_json_struct(array);
+    simjson_free_json_struct(object);
+    simjson_free_json_struct(wrapped);
+}
+
+void test_simjson_encode_gather() {
+    SimjsonArray *array = simjson_array_new();
+    char value[300];
+    memset(value, 'x', sizeof(value));
+    //iovec数量超过单次writev的批量
+    for (size_t i = 0; i < 300; i++) {
+        simjson_array_insert(array, simjson_string_new(value, sizeof(value)), array->size);
+        simjson_array_insert(array, simjson_boolean_new(true), array->size);
+        simjson_array_insert(array, simjson_string_new("short", 5), array->size);
+    }
+    //需要转义的长字符串照常拷贝
+    value[10] = '"';
+    simjson_array_insert(array, simjson_string_new(value, sizeof(value)), array->size);
+
+    size_t expected_length;
+    char *expected = simjson_encode(array, &expected_length);
+
+    SimjsonGather *gather = simjson_encode_gather(array, NULL);
+    TEST_ASSERT_NOT_NULL(gather);
+    TEST_ASSERT_EQUAL_UINT64(expected_length, simjson_gather_length(gather));
+
+    size_t count;
+    const struct iovec *iov = simjson_gather_iovec(gather, &count);
+    //每个长字符串一段，前后的标点与短值各合并为一段
+    TEST_ASSERT_EQUAL_UINT64(601, count);
+    SimjsonString *first = simjson_array_get(array, 0);
+    TEST_ASSERT_TRUE(iov[1].iov_base == first->value);
+
+    char *joined = malloc(expected_length);
+    size_t offset = 0;
+    for (size_t i = 0; i < count; i++) {
+        memcpy(joined + offset, iov[i].iov_base, iov[i].iov_len);
+        offset += iov[i].iov_len;
+    }
+    TEST_ASSERT_EQUAL_MEMORY(expected, joined, expected_length);
+
+    FILE *file = tmpfile();
+    TEST_ASSERT_NOT_NULL(file);
+    TEST_ASSERT_TRUE(simjson_gather_write(gather, fileno(file)));
+    rewind(file);
+    TEST_ASSERT_EQUAL_UINT64(expected_length, fread(joined, 1, expected_length, file));
+    TEST_ASSERT_EQUAL_MEMORY(expected, joined, expected_length);
+    TEST_ASSERT_FALSE(simjson_gather_write(gather, -1));
+
+    SimjsonEncodeOptions unknown = {42, 0};
+    TEST_ASSERT_NULL(simjson_encode_gather(array, &unknown));
+    TEST_ASSERT_NULL(simjson_encode_gather(NULL, NULL));
+
+    fclose(file);
+    free(joined);
+    free(expected);
+    simjson_gather_free(gather);
+    simjson_array_free(array);
+}
+
+void test_simjson_encode_cache() {
+    char *json_str = "{\"users\": [{\"name\": \"Jack\"}, {\"name\": \"Rose\"}], \"config\": {\"debug\": false}}";
+    void *json_struct = simjson_decode(json_str, strlen(json_str));
+    TEST_ASSERT_NOT_NULL(json_struct);
+    simjson_encode_cache_enable(json_struct);
+
+    SimjsonArray *users = simjson_object_get(json_struct, "users", 5);
+    SimjsonObject *config = simjson_object_get(json_struct, "config", 6);
+    SimjsonObject *jack = simjson_array_get(users, 0);
+    SimjsonObject *rose = simjson_array_get(users, 1);
+    TEST_ASSERT_TRUE(users->cache.parent == json_struct);
+    TEST_ASSERT_TRUE(jack->cache.parent == users);
+
+    size_t length;
+    char *first = simjson_encode(json_struct, &length);
+    TEST_ASSERT_NOT_NULL(simjson_encode_cache_of(json_struct)->encoded);
+    TEST_ASSERT_EQUAL_UINT64(length, simjson_encode_cache_of(json_struct)->encoded_length);
+    TEST_ASSERT_EQUAL_MEMORY("{\"debug\": false}", config->cache.encoded, config->cache.encoded_length);
+    char *config_encoded = config->cache.encoded;
+    char *rose_encoded = rose->cache.encoded;
+
+    //修改只使修改路径上的缓存失效
+    TEST_ASSERT_TRUE(simjson_object_add(jack, "age", 3, simjson_boolean_new(true)));
+    TEST_ASSERT_NULL(jack->cache.encoded);
+    TEST_ASSERT_NULL(users->cache.encoded);
+    TEST_ASSERT_NULL(simjson_encode_cache_of(json_struct)->encoded);
+    TEST_ASSERT_TRUE(config->cache.encoded == config_encoded);
+    TEST_ASSERT_TRUE(rose->cache.encoded == rose_encoded);
+
+    //新加入的容器继承缓存设置
+    SimjsonArray *tags = simjson_array_new();
+    TEST_ASSERT_TRUE(simjson_object_add(rose, "tags", 4, tags));
+    TEST_ASSERT_TRUE(tags->cache.enabled);
+    TEST_ASSERT_TRUE(tags->cache.parent == rose);
+
+    char *cached = simjson_encode(json_struct, &length);
+    TEST_ASSERT_EQUAL_UINT64(length, simjson_encoded_size(json_struct));
+    //不同格式不复用缓存
+    SimjsonEncodeOptions compact = {SIMJSON_ENCODE_COMPACT, 0};
+    SimjsonEncodeOptions pretty = {SIMJSON_ENCODE_PRETTY, 2};
+    char *cached_compact = simjson_encode_ex(json_struct, &compact, NULL);
+    char *cached_pretty = simjson_encode_ex(json_struct, &pretty, NULL);
+
+    simjson_encode_cache_disable(json_struct);
+    TEST_ASSERT_NULL(config->cache.encoded);
+    char *fresh = simjson_encode(json_struct, NULL);
+    char *fresh_compact = simjson_encode_ex(json_struct, &compact, NULL);
+    char *fresh_pretty = simjson_encode_ex(json_struct, &pretty, NULL);
+    TEST_ASSERT_EQUAL_STRING(fresh, cached);
+    TEST_ASSERT_EQUAL_STRING(fresh_compact, cached_compact);
+    TEST_ASSERT_EQUAL_STRING(fresh_pretty, cached_pretty);
+
+    //删除同样使路径失效
+    simjson_encode_cache_enable(json_struct);
+    free(simjson_encode(json_struct, NULL));
+    TEST_ASSERT_TRUE(simjson_array_delete(users, 0));
+    TEST_ASSERT_NULL(simjson_encode_cache_of(json_struct)->encoded);
+    TEST_ASSERT_NOT_NULL(config->cache.encoded);
+
+    free(first);
+    free(cached);
+    free(cached_compact);
+    free(cached_pretty);
+    free(fresh);
+    free(fresh_compact);
+    free(fresh_pretty);
+    simjson_free_json_struct(json_struct);
+}
+
+void test_simjson_encode_cache_refs() {
+    //a与e的输出超过128字节，由父容器引用；f较短，直接拷贝进父容器
+    char text[151];
+    memset(text, 'x', 150);
+    text[150] = '\0';
+    char json_str[512];
+    snprintf(json_str, sizeof(json_str),
+             "{\"a\": {\"b\": [1, {\"c\": \"%s\"}]}, \"e\": [true, \"%s\"], \"f\": [false]}", text, text);
+    void *json_struct = simjson_decode(json_str, strlen(json_str));
+    TEST_ASSERT_NOT_NULL(json_struct);
+    simjson_encode_cache_enable(json_struct);
+    SimjsonEncodeCache *cache = simjson_encode_cache_of(json_struct);
+    SimjsonObject *a = simjson_object_get(json_struct, "a", 1);
+    SimjsonArray *e = simjson_object_get(json_struct, "e", 1);
+
+    //父容器只保存自身的字节，较长的子容器输出按偏移引用
+    size_t length;
+    char *first = simjson_encode(json_struct, &length);
+    TEST_ASSERT_EQUAL_STRING(json_str, first);
+    TEST_ASSERT_EQUAL_UINT64(length, cache->encoded_length);
+    TEST_ASSERT_EQUAL_UINT64(2, cache->ref_count);
+    TEST_ASSERT_EQUAL_MEMORY("{\"a\": , \"e\": , \"f\": [false]}", cache->encoded, cache->own_length);
+    TEST_ASSERT_TRUE(cache->refs[0].child == a);
+    TEST_ASSERT_EQUAL_UINT64(6, cache->refs[0].offset);
+    TEST_ASSERT_TRUE(cache->refs[1].child == e);
+    TEST_ASSERT_EQUAL_UINT64(
+        cache->own_length + a->cache.encoded_length + e->cache.encoded_length, cache->encoded_length);
+    char *cached = simjson_encode(json_struct, NULL);
+    TEST_ASSERT_EQUAL_STRING(json_str, cached);
+    free(cached);
+
+    //单独以其它格式编码子树会替换它的缓存，引用它的祖先随之失效
+    SimjsonEncodeOptions compact = {SIMJSON_ENCODE_COMPACT, 0};
+    char *compact_a = simjson_encode_ex(a, &compact, NULL);
+    char expected[512];
+    snprintf(expected, sizeof(expected), "{\"b\":[1,{\"c\":\"%s\"}]}", text);
+    TEST_ASSERT_EQUAL_STRING(expected, compact_a);
+    TEST_ASSERT_NULL(cache->encoded);
+    TEST_ASSERT_NOT_NULL(e->cache.encoded);
+    cached = simjson_encode(json_struct, NULL);
+    TEST_ASSERT_EQUAL_STRING(json_str, cached);
+    free(cached);
+    free(compact_a);
+
+    //子树停用缓存后祖先不再缓存，修改子树时失效在第一个未缓存的容器处停止
+    simjson_encode_cache_disable(a);
+    TEST_ASSERT_NULL(cache->encoded);
+    free(simjson_encode(json_struct, NULL));
+    TEST_ASSERT_NULL(cache->encoded);
+    TEST_ASSERT_NOT_NULL(e->cache.encoded);
+    simjson_encode_cache_enable(a);
+    free(simjson_encode(json_struct, NULL));
+    TEST_ASSERT_NOT_NULL(cache->encoded);
+
+    SimjsonObject *inner = simjson_array_get(simjson_object_get(a, "b", 1), 1);
+    TEST_ASSERT_TRUE(simjson_object_set(inner, "c", 1, simjson_boolean_new(false), NULL));
+    TEST_ASSERT_NULL(cache->encoded);
+    TEST_ASSERT_NOT_NULL(e->cache.encoded);
+    cached = simjson_encode(json_struct, &length);
+    snprintf(expected, sizeof(expected), "{\"a\": {\"b\": [1, {\"c\": false}]}, \"e\": [true, \"%s\"], \"f\": [false]}",
+             text);
+    TEST_ASSERT_EQUAL_STRING(expected, cached);
+    free(cached);
+
+    //固定缓冲区放不下时不保存
+    simjson_encode_cache_invalidate(json_struct);
+    char buf[8];
+    TEST_ASSERT_FALSE(simjson_encode_into(json_struct, buf, sizeof(buf), NULL));
+    TEST_ASSERT_NULL(cache->encoded);
+
+    free(first);
+    simjson_free_json_struct(json_struct);
 }
 
 int main() {
@@ -212,6 +775,8 @@ int main() {
 
     RUN_TEST(test_simjson_decode_encode_string);
     RUN_TEST(test_simjson_decode_string_with_syntax_error);
+    RUN_TEST(test_simjson_decode_string_unescape);
+    RUN_TEST(test_simjson_decode_insitu);
 
     RUN_TEST(test_simjson_decode_encode_number);
     RUN_TEST(test_simjson_decode_number_with_syntax_error);
@@ -226,7 +791,20 @@ int main() {
     RUN_TEST(test_simjson_decode_array_with_syntax_error);
 
     RUN_TEST(test_simjson_decode_encode_object);
+    RUN_TEST(test_simjson_decode_encode_object_order);
     RUN_TEST(test_simjson_decode_object_with_syntax_error);
 
-    UNITY_END();
+    RUN_TEST(test_simjson_encode_escape_long_string);
+    RUN_TEST(test_simjson_encoded_size);
+    RUN_TEST(test_simjson_encode_into);
+    RUN_TEST(test_simjson_encode_to_sink);
+    RUN_TEST(test_simjson_encode_to_fd);
+    RUN_TEST(test_simjson_encode_ex);
+    RUN_TEST(test_simjson_encode_canonical);
+    RUN_TEST(test_simjson_encode_parallel);
+    RUN_TEST(test_simjson_encode_gather);
+    RUN_TEST(test_simjson_encode_cache);
+    RUN_TEST(test_simjson_encode_cache_refs);
+
+    return UNITY_END();
 }
@@ -11,5 +11,5 @@ void test_simjson_null_new() {
 int main() {
     UNITY_BEGIN();
     RUN_TEST(test_simjson_null_new);
-    UNITY_END();
+    return UNITY_END();
 }
\ No newline at end of file
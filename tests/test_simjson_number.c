@@ -27,5 +27,5 @@ int main() {
     RUN_TEST(test_simjson_number_new);
     RUN_TEST(test_simjson_number_with_null);
 
-    UNITY_END();
+    return UNITY_END();
 }
@@ -1,3 +1,5 @@
+#include <stdlib.h>
+
 #include "unity.h"
 #include "simjson.h"
 
@@ -121,7 +123,7 @@ void test_simjson_object_iterator() {
     /* * * * * * * * * * * * * * * * * */
 
     SimjsonObjectIterator *iterator = simjson_object_iterator_new(object);
-    TEST_ASSERT_EQUAL_UINT64(0, iterator->cur_bucket_index);
+    TEST_ASSERT_EQUAL_UINT64(0, iterator->cur_entry_index);
     TEST_ASSERT_EQUAL_UINT64(0, iterator->cur_item_index);
 
     char *key;
@@ -151,6 +153,681 @@ void test_simjson_object_iterator_with_invalid_arg() {
     TEST_ASSERT_NULL(simjson_object_iterator_new(NULL));
 }
 
+void test_simjson_object_iterator_init() {
+    SimjsonObject *object = simjson_object_new(0);
+    simjson_object_add(object, "a", 1, simjson_null_new());
+    simjson_object_add(object, "b", 1, simjson_null_new());
+    simjson_object_add(object, "c", 1, simjson_null_new());
+
+    SimjsonObjectIterator iterator;
+    TEST_ASSERT_TRUE(simjson_object_iterator_init(&iterator, object));
+
+    char *key;
+    size_t key_length;
+    size_t count = 0;
+    while (simjson_object_iterator_has_next(&iterator)) {
+        void *json_struct = simjson_object_iterator_next(&iterator, &key, &key_length);
+        TEST_ASSERT_TRUE(SIMJSON_IS_NULL_TYPE(json_struct));
+        TEST_ASSERT_EQUAL_UINT64(1, key_length);
+        count++;
+    }
+    TEST_ASSERT_EQUAL_UINT64(3, count);
+    TEST_ASSERT_EQUAL_UINT64(object->item_count, iterator.cur_entry_index);
+
+    TEST_ASSERT_FALSE(simjson_object_iterator_init(NULL, object));
+    TEST_ASSERT_FALSE(simjson_object_iterator_init(&iterator, NULL));
+
+    simjson_object_free(object);
+}
+
+void test_simjson_object_grow_and_delete() {
+    SimjsonObject *object = simjson_object_new(0);
+    char key[32];
+    for (int i = 0; i < 2000; i++) {
+        int key_length = snprintf(key, sizeof(key), "key%d", i);
+        int64_t value = i;
+        TEST_ASSERT_TRUE(simjson_object_add(object, key, key_length, simjson_number_new(&value, NULL)));
+    }
+    TEST_ASSERT_EQUAL_UINT64(2000, object->item_size);
+    TEST_ASSERT_TRUE(object->capacity >= 2000);
+
+    //交替删除与插入，已删除的槽位被复用或在重建时清除
+    for (int round = 0; round < 3; round++) {
+        for (int i = round; i < 2000; i += 2) {
+            int key_length = snprintf(key, sizeof(key), "key%d", i);
+            TEST_ASSERT_TRUE(simjson_object_delete(object, key, key_length));
+        }
+        for (int i = round; i < 2000; i += 2) {
+            int key_length = snprintf(key, sizeof(key), "key%d", i);
+            int64_t value = i;
+            TEST_ASSERT_TRUE(simjson_object_add(object, key, key_length, simjson_number_new(&value, NULL)));
+        }
+    }
+
+    for (int i = 0; i < 2000; i++) {
+        int key_length = snprintf(key, sizeof(key), "key%d", i);
+        SimjsonNumber *number = simjson_object_get(object, key, key_length);
+        TEST_ASSERT_NOT_NULL(number);
+        TEST_ASSERT_EQUAL_INT64(i, number->value.integer_value);
+    }
+    TEST_ASSERT_NULL(simjson_object_get(object, "key2000", 7));
+
+    SimjsonObjectIterator iterator;
+    simjson_object_iterator_init(&iterator, object);
+    size_t count = 0;
+    while (simjson_object_iterator_has_next(&iterator)) {
+        simjson_object_iterator_next(&iterator, NULL, NULL);
+        count++;
+    }
+    TEST_ASSERT_EQUAL_UINT64(2000, count);
+
+    simjson_object_free(object);
+}
+
+void test_simjson_object_small() {
+    SimjsonObject *object = simjson_object_new(0);
+    TEST_ASSERT_NULL(object->ctrl);
+    TEST_ASSERT_NULL(object->items);
+
+    char key[8];
+    for (int i = 0; i < 8; i++) {
+        int key_length = snprintf(key, sizeof(key), "k%d", i);
+        int64_t value = i;
+        TEST_ASSERT_TRUE(simjson_object_add(object, key, key_length, simjson_number_new(&value, NULL)));
+    }
+    //8个键值对仍是线性数组
+    TEST_ASSERT_NULL(object->ctrl);
+    TEST_ASSERT_EQUAL_UINT64(8, object->capacity);
+    SimjsonNull *duplicate = simjson_null_new();
+    TEST_ASSERT_FALSE(simjson_object_add(object, "k3", 2, duplicate));
+    simjson_free_json_struct(duplicate);
+
+    //删除后其余键仍可查找，位置被复用
+    TEST_ASSERT_TRUE(simjson_object_delete(object, "k3", 2));
+    TEST_ASSERT_NULL(simjson_object_get(object, "k3", 2));
+    TEST_ASSERT_EQUAL_INT64(7, ((SimjsonNumber *) simjson_object_get(object, "k7", 2))->value.integer_value);
+    TEST_ASSERT_TRUE(simjson_object_add(object, "k3", 2, simjson_null_new()));
+    TEST_ASSERT_NULL(object->ctrl);
+
+    //超过8个转为哈希表
+    TEST_ASSERT_TRUE(simjson_object_add(object, "k8", 2, simjson_null_new()));
+    TEST_ASSERT_NOT_NULL(object->ctrl);
+    TEST_ASSERT_EQUAL_UINT64(9, object->item_size);
+    for (int i = 0; i < 9; i++) {
+        int key_length = snprintf(key, sizeof(key), "k%d", i);
+        TEST_ASSERT_NOT_NULL(simjson_object_get(object, key, key_length));
+    }
+
+    simjson_object_free(object);
+
+    //预计数量较多时直接建表
+    object = simjson_object_new(100);
+    TEST_ASSERT_NOT_NULL(object->ctrl);
+    TEST_ASSERT_TRUE(object->capacity >= 100);
+    simjson_object_free(object);
+}
+
+void test_simjson_object_insertion_order() {
+    SimjsonObject *object = simjson_object_new(0);
+    char key[16];
+    for (int i = 0; i < 100; i++) {
+        int key_length = snprintf(key, sizeof(key), "key%d", i);
+        int64_t value = i;
+        TEST_ASSERT_TRUE(simjson_object_add(object, key, key_length, simjson_number_new(&value, NULL)));
+    }
+    //删除偶数键后再添加，新键排在末尾
+    for (int i = 0; i < 100; i += 2) {
+        int key_length = snprintf(key, sizeof(key), "key%d", i);
+        TEST_ASSERT_TRUE(simjson_object_delete(object, key, key_length));
+    }
+    for (int i = 100; i < 200; i++) {
+        int key_length = snprintf(key, sizeof(key), "key%d", i);
+        int64_t value = i;
+        TEST_ASSERT_TRUE(simjson_object_add(object, key, key_length, simjson_number_new(&value, NULL)));
+    }
+    //经过压缩，items中不再有空位
+    TEST_ASSERT_EQUAL_UINT64(150, object->item_size);
+    TEST_ASSERT_EQUAL_UINT64(150, object->item_count);
+
+    SimjsonObjectIterator iterator;
+    simjson_object_iterator_init(&iterator, object);
+    int expected = 1;
+    while (simjson_object_iterator_has_next(&iterator)) {
+        char *iter_key;
+        size_t iter_key_length;
+        SimjsonNumber *number = simjson_object_iterator_next(&iterator, &iter_key, &iter_key_length);
+        int key_length = snprintf(key, sizeof(key), "key%d", expected);
+        TEST_ASSERT_EQUAL_INT64(expected, number->value.integer_value);
+        TEST_ASSERT_EQUAL_UINT64(key_length, iter_key_length);
+        TEST_ASSERT_EQUAL_MEMORY(key, iter_key, key_length);
+        expected = expected < 99 ? expected + 2 : (expected == 99 ? 100 : expected + 1);
+    }
+    TEST_ASSERT_EQUAL_INT64(200, expected);
+
+    simjson_object_free(object);
+}
+
+void test_simjson_object_key_lengths() {
+    //覆盖内联与单独分配两种键，以及小object转换为哈希表前后
+    const size_t lengths[] = {1, 14, 15, 16, 17, 100, 1000};
+    const size_t count = sizeof(lengths) / sizeof(lengths[0]);
+    char key[1001];
+
+    SimjsonObject *object = simjson_object_new(0);
+    for (int round = 0; round < 3; round++) {
+        for (size_t i = 0; i < count; i++) {
+            memset(key, 'a' + round, lengths[i]);
+            key[lengths[i]] = '\0';
+            TEST_ASSERT_TRUE(simjson_object_add(object, key, lengths[i], simjson_null_new()));
+        }
+    }
+    TEST_ASSERT_NOT_NULL(object->ctrl);
+
+    SimjsonObjectIterator iterator;
+    simjson_object_iterator_init(&iterator, object);
+    for (int round = 0; round < 3; round++) {
+        for (size_t i = 0; i < count; i++) {
+            char *iter_key;
+            size_t iter_key_length;
+            simjson_object_iterator_next(&iterator, &iter_key, &iter_key_length);
+            memset(key, 'a' + round, lengths[i]);
+            key[lengths[i]] = '\0';
+            TEST_ASSERT_EQUAL_UINT64(lengths[i], iter_key_length);
+            TEST_ASSERT_EQUAL_STRING(key, iter_key);
+            TEST_ASSERT_NOT_NULL(simjson_object_get(object, key, lengths[i]));
+        }
+    }
+
+    //只有长度相同、内容不同的键
+    memset(key, 'a', 16);
+    key[15] = 'z';
+    TEST_ASSERT_NULL(simjson_object_get(object, key, 16));
+    for (size_t i = 0; i < count; i++) {
+        memset(key, 'b', lengths[i]);
+        TEST_ASSERT_TRUE(simjson_object_delete(object, key, lengths[i]));
+        TEST_ASSERT_NULL(simjson_object_get(object, key, lengths[i]));
+    }
+    TEST_ASSERT_EQUAL_UINT64(2 * count, object->item_size);
+
+    simjson_object_free(object);
+}
+
+void test_simjson_object_get_k() {
+    SimjsonKey id = simjson_key_make("id", 2);
+    SimjsonKey missing = simjson_key_make("ts", 2);
+    TEST_ASSERT_EQUAL_UINT64(2, id.key_length);
+
+    //小object与哈希表两种布局
+    for (int count = 1; count <= 64; count *= 8) {
+        SimjsonObject *object = simjson_object_new(0);
+        char key[16];
+        for (int i = 0; i < count; i++) {
+            int key_length = snprintf(key, sizeof(key), "key%d", i);
+            TEST_ASSERT_TRUE(simjson_object_add(object, key, key_length, simjson_null_new()));
+        }
+        int64_t value = count;
+        TEST_ASSERT_TRUE(simjson_object_add(object, "id", 2, simjson_number_new(&value, NULL)));
+
+        SimjsonNumber *number = simjson_object_get_k(object, &id);
+        TEST_ASSERT_NOT_NULL(number);
+        TEST_ASSERT_EQUAL_INT64(count, number->value.integer_value);
+        TEST_ASSERT_NULL(simjson_object_get_k(object, &missing));
+
+        simjson_object_free(object);
+    }
+
+    SimjsonKey empty = simjson_key_make(NULL, 2);
+    TEST_ASSERT_EQUAL_UINT64(0, empty.key_length);
+    SimjsonObject *object = simjson_object_new(0);
+    TEST_ASSERT_NULL(simjson_object_get_k(object, &empty));
+    TEST_ASSERT_NULL(simjson_object_get_k(object, NULL));
+    TEST_ASSERT_NULL(simjson_object_get_k(NULL, &id));
+    simjson_object_free(object);
+}
+
+void test_simjson_object_from_entries() {
+    //小object与哈希表两种布局，键值对保持给定的顺序
+    for (size_t count = 3; count <= 30; count *= 10) {
+        char key_buf[30][8];
+        const char *keys[30];
+        size_t key_lengths[30];
+        void *values[30];
+        for (size_t i = 0; i < count; i++) {
+            key_lengths[i] = snprintf(key_buf[i], sizeof(key_buf[i]), "k%zu", count - i);
+            keys[i] = key_buf[i];
+            int64_t value = (int64_t) i;
+            values[i] = simjson_number_new(&value, NULL);
+        }
+
+        SimjsonObject *object = simjson_object_from_entries(keys, key_lengths, values, count, count > 3);
+        TEST_ASSERT_NOT_NULL(object);
+        TEST_ASSERT_EQUAL_UINT64(count, object->item_size);
+
+        SimjsonObjectIterator iterator;
+        simjson_object_iterator_init(&iterator, object);
+        for (size_t i = 0; i < count; i++) {
+            char *key;
+            size_t key_length;
+            SimjsonNumber *number = simjson_object_iterator_next(&iterator, &key, &key_length);
+            TEST_ASSERT_EQUAL_MEMORY(keys[i], key, key_length);
+            TEST_ASSERT_EQUAL_INT64((int64_t) i, number->value.integer_value);
+            TEST_ASSERT_EQUAL_PTR(number, simjson_object_get(object, keys[i], key_lengths[i]));
+        }
+
+        simjson_object_free(object);
+    }
+
+    //重复的键导致失败，值仍归调用者
+    const char *keys[] = {"a", "b", "a"};
+    size_t key_lengths[] = {1, 1, 1};
+    void *values[] = {simjson_null_new(), simjson_null_new(), simjson_null_new()};
+    TEST_ASSERT_NULL(simjson_object_from_entries(keys, key_lengths, values, 3, false));
+    for (int i = 0; i < 3; i++) {
+        simjson_free_json_struct(values[i]);
+    }
+
+    SimjsonObject *object = simjson_object_from_entries(NULL, NULL, NULL, 0, false);
+    TEST_ASSERT_NOT_NULL(object);
+    TEST_ASSERT_EQUAL_UINT64(0, object->item_size);
+    simjson_object_free(object);
+    TEST_ASSERT_NULL(simjson_object_from_entries(NULL, NULL, NULL, 1, false));
+}
+
+void test_simjson_object_reserve() {
+    SimjsonObject *object = simjson_object_new(0);
+    TEST_ASSERT_TRUE(simjson_object_reserve(object, 5));
+    TEST_ASSERT_NULL(object->ctrl);
+    TEST_ASSERT_EQUAL_UINT64(5, object->capacity);
+
+    TEST_ASSERT_TRUE(simjson_object_reserve(object, 1000));
+    size_t capacity = object->capacity;
+    TEST_ASSERT_TRUE(capacity - capacity / 8 >= 1000);
+    char key[16];
+    for (int i = 0; i < 1000; i++) {
+        int key_length = snprintf(key, sizeof(key), "key%d", i);
+        TEST_ASSERT_TRUE(simjson_object_add(object, key, key_length, simjson_null_new()));
+    }
+    //预留后添加不会扩容
+    TEST_ASSERT_EQUAL_UINT64(capacity, object->capacity);
+    TEST_ASSERT_TRUE(simjson_object_reserve(object, 10));
+    TEST_ASSERT_EQUAL_UINT64(capacity, object->capacity);
+
+    TEST_ASSERT_FALSE(simjson_object_reserve(NULL, 10));
+    simjson_object_free(object);
+}
+
+void test_simjson_object_freeze() {
+    //小object与哈希表两种布局，哈希表中含已删除的空位
+    for (int count = 5; count <= 50000; count *= 100) {
+        SimjsonObject *object = simjson_object_new(0);
+        char key[32];
+        for (int i = 0; i < count; i++) {
+            int key_length = snprintf(key, sizeof(key), i % 2 ? "key%d" : "a_rather_long_key_%d", i);
+            int64_t value = i;
+            TEST_ASSERT_TRUE(simjson_object_add(object, key, key_length, simjson_number_new(&value, NULL)));
+        }
+        if (count > 8) {
+            TEST_ASSERT_TRUE(simjson_object_delete(object, "key1", 4));
+        }
+        size_t item_size = object->item_size;
+
+        TEST_ASSERT_TRUE(simjson_object_freeze(object));
+        TEST_ASSERT_NOT_NULL(object->frozen);
+        TEST_ASSERT_NULL(object->ctrl);
+        TEST_ASSERT_TRUE(simjson_object_freeze(object));
+        TEST_ASSERT_EQUAL_UINT64(item_size, object->item_size);
+
+        for (int i = 0; i < count; i++) {
+            int key_length = snprintf(key, sizeof(key), i % 2 ? "key%d" : "a_rather_long_key_%d", i);
+            SimjsonNumber *number = simjson_object_get(object, key, key_length);
+            if (count > 8 && i == 1) {
+                TEST_ASSERT_NULL(number);
+                continue;
+            }
+            TEST_ASSERT_NOT_NULL(number);
+            TEST_ASSERT_EQUAL_INT64(i, number->value.integer_value);
+        }
+        TEST_ASSERT_NULL(simjson_object_get(object, "missing", 7));
+        SimjsonKey handle = simjson_key_make("key3", 4);
+        TEST_ASSERT_NOT_NULL(simjson_object_get_k(object, &handle));
+
+        //只读
+        SimjsonNull *null = simjson_null_new();
+        TEST_ASSERT_FALSE(simjson_object_add(object, "new", 3, null));
+        simjson_free_json_struct(null);
+        TEST_ASSERT_FALSE(simjson_object_delete(object, "key3", 4));
+        TEST_ASSERT_FALSE(simjson_object_reserve(object, 100000));
+
+        //顺序不变
+        SimjsonObjectIterator iterator;
+        simjson_object_iterator_init(&iterator, object);
+        int64_t last = -1;
+        while (simjson_object_iterator_has_next(&iterator)) {
+            SimjsonNumber *number = simjson_object_iterator_next(&iterator, NULL, NULL);
+            TEST_ASSERT_TRUE(number->value.integer_value > last);
+            last = number->value.integer_value;
+        }
+        TEST_ASSERT_EQUAL_INT64(count - 1, last);
+
+        simjson_object_free(object);
+    }
+
+    SimjsonObject *object = simjson_object_new(100);
+    TEST_ASSERT_TRUE(simjson_object_freeze(object));
+    TEST_ASSERT_NULL(simjson_object_get(object, "a", 1));
+    simjson_object_free(object);
+    TEST_ASSERT_FALSE(simjson_object_freeze(NULL));
+}
+
+void test_simjson_object_set_take_slot() {
+    //小object与哈希表两种布局
+    for (int count = 2; count <= 200; count *= 100) {
+        SimjsonObject *object = simjson_object_new(0);
+        char key[16];
+        for (int i = 0; i < count; i++) {
+            int key_length = snprintf(key, sizeof(key), "key%d", i);
+            TEST_ASSERT_TRUE(simjson_object_set(object, key, key_length, simjson_null_new(), NULL));
+        }
+        TEST_ASSERT_EQUAL_UINT64(count, object->item_size);
+
+        //替换并取回旧值
+        int64_t value = 42;
+        SimjsonNumber *number = simjson_number_new(&value, NULL);
+        void *old = NULL;
+        TEST_ASSERT_TRUE(simjson_object_set(object, "key1", 4, number, &old));
+        TEST_ASSERT_TRUE(SIMJSON_IS_NULL_TYPE(old));
+        simjson_free_json_struct(old);
+        TEST_ASSERT_EQUAL_PTR(number, simjson_object_get(object, "key1", 4));
+        TEST_ASSERT_EQUAL_UINT64(count, object->item_size);
+        //同一个值不会被释放
+        TEST_ASSERT_TRUE(simjson_object_set(object, "key1", 4, number, NULL));
+        TEST_ASSERT_EQUAL_PTR(number, simjson_object_get(object, "key1", 4));
+        //替换时直接释放旧值
+        TEST_ASSERT_TRUE(simjson_object_set(object, "key0", 4, simjson_boolean_new(true), NULL));
+
+        TEST_ASSERT_EQUAL_PTR(number, simjson_object_take(object, "key1", 4));
+        TEST_ASSERT_NULL(simjson_object_get(object, "key1", 4));
+        TEST_ASSERT_NULL(simjson_object_take(object, "key1", 4));
+        TEST_ASSERT_EQUAL_UINT64(count - 1, object->item_size);
+
+        bool inserted;
+        void **slot = simjson_object_get_or_insert_slot(object, "key1", 4, number, &inserted);
+        TEST_ASSERT_TRUE(inserted);
+        TEST_ASSERT_EQUAL_PTR(number, *slot);
+        //键已存在时无需预先分配值
+        slot = simjson_object_get_or_insert_slot(object, "key1", 4, NULL, &inserted);
+        TEST_ASSERT_FALSE(inserted);
+        TEST_ASSERT_EQUAL_PTR(number, *slot);
+        TEST_ASSERT_EQUAL_UINT64(count, object->item_size);
+
+        //键不存在时由调用者写入值
+        slot = simjson_object_get_or_insert_slot(object, "new", 3, NULL, &inserted);
+        TEST_ASSERT_TRUE(inserted);
+        TEST_ASSERT_NULL(*slot);
+        *slot = simjson_boolean_new(true);
+        TEST_ASSERT_TRUE(simjson_object_slot_commit(object, slot));
+        TEST_ASSERT_TRUE(SIMJSON_IS_BOOLEAN_TYPE(simjson_object_get(object, "new", 3)));
+
+        //未写入值时提交即撤销插入
+        slot = simjson_object_get_or_insert_slot(object, "none", 4, NULL, &inserted);
+        TEST_ASSERT_TRUE(inserted);
+        TEST_ASSERT_TRUE(simjson_object_slot_commit(object, slot));
+        TEST_ASSERT_NULL(simjson_object_get(object, "none", 4));
+        TEST_ASSERT_EQUAL_UINT64(count + 1, object->item_size);
+
+        simjson_object_free(object);
+    }
+
+    //替换会使编码缓存失效
+    SimjsonObject *object = simjson_object_new(0);
+    SimjsonObject *inner = simjson_object_new(0);
+    simjson_object_set(inner, "a", 1, simjson_null_new(), NULL);
+    simjson_object_set(object, "inner", 5, inner, NULL);
+    simjson_encode_cache_enable(object);
+    size_t length;
+    char *encoded = simjson_encode(object, &length);
+    free(encoded);
+    simjson_object_set(inner, "a", 1, simjson_boolean_new(false), NULL);
+    encoded = simjson_encode(object, &length);
+    TEST_ASSERT_EQUAL_MEMORY("{\"inner\": {\"a\": false}}", encoded, length);
+    free(encoded);
+
+    //经由位置替换的值提交后同样使缓存失效
+    void **slot = simjson_object_get_or_insert_slot(inner, "a", 1, NULL, NULL);
+    simjson_free_json_struct(*slot);
+    *slot = simjson_null_new();
+    TEST_ASSERT_TRUE(simjson_object_slot_commit(inner, slot));
+    encoded = simjson_encode(object, &length);
+    TEST_ASSERT_EQUAL_MEMORY("{\"inner\": {\"a\": null}}", encoded, length);
+    free(encoded);
+    TEST_ASSERT_FALSE(simjson_object_slot_commit(object, slot));
+    TEST_ASSERT_FALSE(simjson_object_slot_commit(inner, NULL));
+
+    //取出的子容器不再关联原object
+    SimjsonObject *taken = simjson_object_take(object, "inner", 5);
+    TEST_ASSERT_EQUAL_PTR(inner, taken);
+    TEST_ASSERT_NULL(taken->cache.parent);
+    simjson_object_free(taken);
+
+    TEST_ASSERT_FALSE(simjson_object_set(NULL, "a", 1, object, NULL));
+    TEST_ASSERT_FALSE(simjson_object_set(object, "a", 1, NULL, NULL));
+    TEST_ASSERT_NULL(simjson_object_take(NULL, "a", 1));
+    TEST_ASSERT_NULL(simjson_object_get_or_insert_slot(object, NULL, 1, object, NULL));
+
+    simjson_object_freeze(object);
+    SimjsonNull *null = simjson_null_new();
+    TEST_ASSERT_FALSE(simjson_object_set(object, "b", 1, null, NULL));
+    TEST_ASSERT_NULL(simjson_object_get_or_insert_slot(object, "b", 1, null, NULL));
+    simjson_free_json_struct(null);
+    simjson_object_free(object);
+}
+
+static void test_merge_patch(const char *target_str, const char *patch_str, const char *expected) {
+    void *target = simjson_decode(target_str, strlen(target_str));
+    void *patch = simjson_decode(patch_str, strlen(patch_str));
+    TEST_ASSERT_NOT_NULL(target);
+    TEST_ASSERT_NOT_NULL(patch);
+    TEST_ASSERT_TRUE(simjson_merge_patch(&target, patch));
+
+    SimjsonEncodeOptions options = {SIMJSON_ENCODE_COMPACT, 0};
+    size_t length;
+    char *encoded = simjson_encode_ex(target, &options, &length);
+    TEST_ASSERT_EQUAL_UINT64(strlen(expected), length);
+    TEST_ASSERT_EQUAL_MEMORY(expected, encoded, length);
+    free(encoded);
+    simjson_free_json_struct(target);
+}
+
+void test_simjson_merge_patch() {
+    //RFC 7396附录A
+    test_merge_patch("{\"a\":\"b\"}", "{\"a\":\"c\"}", "{\"a\":\"c\"}");
+    test_merge_patch("{\"a\":\"b\"}", "{\"b\":\"c\"}", "{\"a\":\"b\",\"b\":\"c\"}");
+    test_merge_patch("{\"a\":\"b\"}", "{\"a\":null}", "{}");
+    test_merge_patch("{\"a\":\"b\",\"b\":\"c\"}", "{\"a\":null}", "{\"b\":\"c\"}");
+    test_merge_patch("{\"a\":[\"b\"]}", "{\"a\":\"c\"}", "{\"a\":\"c\"}");
+    test_merge_patch("{\"a\":\"c\"}", "{\"a\":[\"b\"]}", "{\"a\":[\"b\"]}");
+    test_merge_patch("{\"a\":{\"b\":\"c\"}}", "{\"a\":{\"b\":\"d\",\"c\":null}}", "{\"a\":{\"b\":\"d\"}}");
+    test_merge_patch("{\"a\":[{\"b\":\"c\"}]}", "{\"a\":[1]}", "{\"a\":[1]}");
+    test_merge_patch("[\"a\",\"b\"]", "[\"c\",\"d\"]", "[\"c\",\"d\"]");
+    test_merge_patch("{\"a\":\"b\"}", "[\"c\"]", "[\"c\"]");
+    test_merge_patch("{\"a\":\"foo\"}", "null", "null");
+    test_merge_patch("{\"a\":\"foo\"}", "\"bar\"", "\"bar\"");
+    test_merge_patch("{\"e\":null}", "{\"a\":1}", "{\"e\":null,\"a\":1}");
+    test_merge_patch("[1,2]", "{\"a\":\"b\",\"c\":null}", "{\"a\":\"b\"}");
+    test_merge_patch("{}", "{\"a\":{\"bb\":{\"ccc\":null}}}", "{\"a\":{\"bb\":{}}}");
+
+    //嵌套object原位合并，缓存随之失效；patch中的值直接移入
+    SimjsonObject *target = simjson_object_new(0);
+    SimjsonObject *inner = simjson_object_new(0);
+    char key[16];
+    for (int i = 0; i < 20; i++) {
+        int key_length = snprintf(key, sizeof(key), "k%d", i);
+        int64_t value = i;
+        simjson_object_add(inner, key, key_length, simjson_number_new(&value, NULL));
+    }
+    simjson_object_add(target, "inner", 5, inner);
+    simjson_encode_cache_enable(target);
+    size_t length;
+    free(simjson_encode(target, &length));
+
+    SimjsonObject *patch = simjson_object_new(0);
+    SimjsonObject *inner_patch = simjson_object_new(0);
+    SimjsonString *string = simjson_string_new("x", 1);
+    simjson_object_add(inner_patch, "k3", 2, string);
+    simjson_object_add(inner_patch, "k5", 2, simjson_null_new());
+    simjson_object_add(inner_patch, "k6", 2, simjson_null_new());
+    simjson_object_add(patch, "inner", 5, inner_patch);
+    void *document = target;
+    TEST_ASSERT_TRUE(simjson_merge_patch(&document, patch));
+    TEST_ASSERT_EQUAL_PTR(target, document);
+    TEST_ASSERT_EQUAL_PTR(inner, simjson_object_get(target, "inner", 5));
+    TEST_ASSERT_EQUAL_PTR(string, simjson_object_get(inner, "k3", 2));
+    TEST_ASSERT_NULL(simjson_object_get(inner, "k5", 2));
+    TEST_ASSERT_EQUAL_UINT64(18, inner->item_size);
+
+    //带缓存的编码结果与不使用缓存时一致
+    size_t cached_length;
+    char *cached = simjson_encode(target, &cached_length);
+    simjson_encode_cache_disable(target);
+    char *encoded = simjson_encode(target, &length);
+    TEST_ASSERT_EQUAL_UINT64(length, cached_length);
+    TEST_ASSERT_EQUAL_MEMORY(encoded, cached, length);
+    free(cached);
+    free(encoded);
+
+    //冻结的object拒绝修改
+    simjson_object_freeze(inner);
+    patch = simjson_object_new(0);
+    inner_patch = simjson_object_new(0);
+    simjson_object_add(inner_patch, "k1", 2, simjson_null_new());
+    simjson_object_add(patch, "inner", 5, inner_patch);
+    TEST_ASSERT_FALSE(simjson_merge_patch(&document, patch));
+    TEST_ASSERT_NOT_NULL(simjson_object_get(inner, "k1", 2));
+
+    //patch中冻结的object含有null成员时无法去掉，整个合并在修改前失败
+    patch = simjson_object_new(0);
+    inner_patch = simjson_object_new(0);
+    simjson_object_add(inner_patch, "n", 1, simjson_null_new());
+    simjson_object_freeze(inner_patch);
+    simjson_object_add(patch, "a", 1, simjson_string_new("x", 1));
+    simjson_object_add(patch, "k0", 2, simjson_null_new());
+    simjson_object_add(patch, "frozen", 6, inner_patch);
+    size_t target_size = target->item_size;
+    TEST_ASSERT_FALSE(simjson_merge_patch(&document, patch));
+    TEST_ASSERT_EQUAL_UINT64(target_size, target->item_size);
+    TEST_ASSERT_NULL(simjson_object_get(target, "a", 1));
+
+    void *replaced = simjson_object_new(0);
+    patch = simjson_object_new(0);
+    inner_patch = simjson_object_new(0);
+    simjson_object_add(inner_patch, "n", 1, simjson_null_new());
+    simjson_object_freeze(inner_patch);
+    simjson_object_add(patch, "frozen", 6, inner_patch);
+    TEST_ASSERT_FALSE(simjson_merge_patch(&replaced, patch));
+    TEST_ASSERT_TRUE(SIMJSON_IS_OBJECT_TYPE(replaced));
+    simjson_free_json_struct(replaced);
+
+    //冻结的object中没有null成员时原样移入，其中未冻结的子object照常去掉null
+    patch = simjson_object_new(0);
+    inner_patch = simjson_object_new(0);
+    SimjsonObject *nested = simjson_object_new(0);
+    simjson_object_add(nested, "n", 1, simjson_null_new());
+    simjson_object_add(nested, "s", 1, simjson_string_new("y", 1));
+    simjson_object_add(inner_patch, "nested", 6, nested);
+    simjson_object_freeze(inner_patch);
+    simjson_object_add(patch, "frozen", 6, inner_patch);
+    TEST_ASSERT_TRUE(simjson_merge_patch(&document, patch));
+    TEST_ASSERT_EQUAL_PTR(inner_patch, simjson_object_get(target, "frozen", 6));
+    TEST_ASSERT_NULL(simjson_object_get(nested, "n", 1));
+    TEST_ASSERT_EQUAL_UINT64(1, nested->item_size);
+
+    SimjsonNull *null = simjson_null_new();
+    TEST_ASSERT_FALSE(simjson_merge_patch(NULL, null));
+    simjson_free_json_struct(null);
+
+    simjson_object_free(target);
+}
+
+void test_simjson_object_colliding_keys() {
+    //"aB"与"b!"的djb2值相同，由它们拼接出的4096个键在djb2下全部冲突
+    SimjsonObject *object = simjson_object_new(0);
+    char key[25];
+    for (int i = 0; i < 4096; i++) {
+        for (int bit = 0; bit < 12; bit++) {
+            memcpy(key + bit * 2, (i >> bit) & 1 ? "b!" : "aB", 2);
+        }
+        TEST_ASSERT_TRUE(simjson_object_add(object, key, 24, simjson_null_new()));
+    }
+    TEST_ASSERT_EQUAL_UINT64(4096, object->item_size);
+
+    for (int i = 0; i < 4096; i++) {
+        for (int bit = 0; bit < 12; bit++) {
+            memcpy(key + bit * 2, (i >> bit) & 1 ? "b!" : "aB", 2);
+        }
+        TEST_ASSERT_NOT_NULL(simjson_object_get(object, key, 24));
+    }
+
+    simjson_object_free(object);
+}
+
+void test_simjson_object_iterator_key_fragment() {
+    char borrowed[] = "a long borrowed key\tthat is not inlined";
+    SimjsonObject *object = simjson_object_new(0);
+    simjson_object_add(object, "a\"b\n", 4, simjson_null_new());
+    simjson_object_add_borrowed(object, borrowed, strlen(borrowed), simjson_null_new());
+    simjson_object_add(object, "a long owned key that is not inlined", 36, simjson_null_new());
+
+    SimjsonObjectIterator iterator;
+    simjson_object_iterator_init(&iterator, object);
+    TEST_ASSERT_NULL(simjson_object_iterator_key_fragment(&iterator, NULL));
+
+    //片段在插入时生成，冻结后随键一起移入key_blob
+    for (int round = 0; round < 2; round++) {
+        simjson_object_iterator_init(&iterator, object);
+        size_t length;
+        simjson_object_iterator_next(&iterator, NULL, NULL);
+        const char *fragment = simjson_object_iterator_key_fragment(&iterator, &length);
+        TEST_ASSERT_EQUAL_UINT64(strlen("\"a\\\"b\\n\": "), length);
+        TEST_ASSERT_EQUAL_MEMORY("\"a\\\"b\\n\": ", fragment, length);
+
+        simjson_object_iterator_next(&iterator, NULL, NULL);
+        fragment = simjson_object_iterator_key_fragment(&iterator, &length);
+        TEST_ASSERT_EQUAL_UINT64(strlen("\"a long borrowed key\\tthat is not inlined\": "), length);
+        TEST_ASSERT_EQUAL_MEMORY("\"a long borrowed key\\tthat is not inlined\": ", fragment, length);
+
+        char *key;
+        size_t key_length;
+        simjson_object_iterator_next(&iterator, &key, &key_length);
+        TEST_ASSERT_EQUAL_STRING("a long owned key that is not inlined", key);
+        fragment = simjson_object_iterator_key_fragment(&iterator, &length);
+        TEST_ASSERT_EQUAL_MEMORY("\"a long owned key that is not inlined\": ", fragment, length);
+
+        TEST_ASSERT_TRUE(simjson_object_freeze(object));
+    }
+
+    simjson_object_free(object);
+}
+
+void test_simjson_object_encode_key() {
+    SimjsonObject *object = simjson_object_new(0);
+    simjson_object_add(object, "a\"b\n", 4, simjson_null_new());
+    simjson_object_add(object, "c", 1, simjson_null_new());
+
+    char *expected = "{\"a\\\"b\\n\": null, \"c\": null}";
+    TEST_ASSERT_EQUAL_UINT64(strlen(expected), simjson_encoded_size(object));
+    size_t length;
+    char *encoded = simjson_encode(object, &length);
+    TEST_ASSERT_EQUAL_STRING(expected, encoded);
+    free(encoded);
+
+    SimjsonEncodeOptions options = {SIMJSON_ENCODE_COMPACT, 0};
+    encoded = simjson_encode_ex(object, &options, &length);
+    TEST_ASSERT_EQUAL_STRING("{\"a\\\"b\\n\":null,\"c\":null}", encoded);
+    free(encoded);
+
+    simjson_object_free(object);
+}
+
 int main() {
     UNITY_BEGIN();
 
@@ -161,7 +838,21 @@ int main() {
     RUN_TEST(test_simjson_object_crud_with_invalid_arg);
     RUN_TEST(test_simjson_object_iterator);
     RUN_TEST(test_simjson_object_iterator_with_invalid_arg);
-
-    UNITY_END();
+    RUN_TEST(test_simjson_object_iterator_init);
+    RUN_TEST(test_simjson_object_grow_and_delete);
+    RUN_TEST(test_simjson_object_small);
+    RUN_TEST(test_simjson_object_insertion_order);
+    RUN_TEST(test_simjson_object_key_lengths);
+    RUN_TEST(test_simjson_object_get_k);
+    RUN_TEST(test_simjson_object_from_entries);
+    RUN_TEST(test_simjson_object_reserve);
+    RUN_TEST(test_simjson_object_freeze);
+    RUN_TEST(test_simjson_object_set_take_slot);
+    RUN_TEST(test_simjson_merge_patch);
+    RUN_TEST(test_simjson_object_colliding_keys);
+    RUN_TEST(test_simjson_object_iterator_key_fragment);
+    RUN_TEST(test_simjson_object_encode_key);
+
+    return UNITY_END();
 }
 
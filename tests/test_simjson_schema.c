@@ -0,0 +1,223 @@
+#include <stdlib.h>
+
+#include "unity.h"
+#include "simjson.h"
+
+typedef struct {
+    double lat;
+    double lng;
+} Location;
+
+typedef struct {
+    int64_t id;
+    int32_t age;
+    bool married;
+    char *name;
+    char city[8];
+    Location location;
+    int64_t *scores;
+    size_t score_count;
+    char **tags;
+    size_t tag_count;
+    Location *history;
+    size_t history_count;
+} Person;
+
+static const SimjsonField LOCATION_FIELDS[] = {
+        SIMJSON_SCHEMA_FIELD(Location, lat, SIMJSON_FIELD_DOUBLE),
+        SIMJSON_SCHEMA_FIELD(Location, lng, SIMJSON_FIELD_DOUBLE),
+};
+
+static const SimjsonSchema LOCATION_SCHEMA = SIMJSON_SCHEMA(Location, LOCATION_FIELDS);
+
+static const SimjsonField PERSON_FIELDS[] = {
+        SIMJSON_SCHEMA_FIELD(Person, id, SIMJSON_FIELD_INT64),
+        SIMJSON_SCHEMA_FIELD(Person, age, SIMJSON_FIELD_INT32),
+        SIMJSON_SCHEMA_FIELD(Person, married, SIMJSON_FIELD_BOOLEAN),
+        SIMJSON_SCHEMA_FIELD(Person, name, SIMJSON_FIELD_STRING),
+        SIMJSON_SCHEMA_CHARS(Person, city),
+        SIMJSON_SCHEMA_OBJECT(Person, location, LOCATION_SCHEMA),
+        SIMJSON_SCHEMA_ARRAY(Person, scores, score_count, SIMJSON_FIELD_INT64, NULL),
+        SIMJSON_SCHEMA_ARRAY(Person, tags, tag_count, SIMJSON_FIELD_STRING, NULL),
+        SIMJSON_SCHEMA_ARRAY(Person, history, history_count, SIMJSON_FIELD_OBJECT, &LOCATION_SCHEMA),
+};
+
+static const SimjsonSchema PERSON_SCHEMA = SIMJSON_SCHEMA(Person, PERSON_FIELDS);
+
+void test_simjson_decode_into() {
+    char *json_str = "{\"id\": 42, \"name\": \"Ja\\nck\", \"unknown\": {\"a\": [1, {\"b\": null}]}, \"age\": 30,"
+                     " \"married\": true, \"city\": \"NY\", \"location\": {\"lat\": 1.5, \"lng\": -2},"
+                     " \"scores\": [1, 2, 3, 4, 5], \"tags\": [\"a\", \"b\"], \"history\": [{\"lat\": 3}]}";
+    Person person;
+    TEST_ASSERT_TRUE(simjson_decode_into(&PERSON_SCHEMA, &person, json_str, strlen(json_str)));
+
+    TEST_ASSERT_EQUAL_INT64(42, person.id);
+    TEST_ASSERT_EQUAL_INT32(30, person.age);
+    TEST_ASSERT_TRUE(person.married);
+    TEST_ASSERT_EQUAL_STRING("Ja\nck", person.name);
+    TEST_ASSERT_EQUAL_STRING("NY", person.city);
+    TEST_ASSERT_TRUE(person.location.lat == 1.5);
+    TEST_ASSERT_TRUE(person.location.lng == -2);
+
+    TEST_ASSERT_EQUAL_UINT64(5, person.score_count);
+    TEST_ASSERT_EQUAL_INT64(5, person.scores[4]);
+    TEST_ASSERT_EQUAL_UINT64(2, person.tag_count);
+    TEST_ASSERT_EQUAL_STRING("b", person.tags[1]);
+    TEST_ASSERT_EQUAL_UINT64(1, person.history_count);
+    TEST_ASSERT_TRUE(person.history[0].lat == 3);
+
+    simjson_schema_free(&PERSON_SCHEMA, &person);
+    TEST_ASSERT_NULL(person.name);
+    TEST_ASSERT_NULL(person.scores);
+}
+
+void test_simjson_decode_into_missing_and_null() {
+    char *json_str = "{\"name\": null, \"scores\": []}";
+    Person person;
+    TEST_ASSERT_TRUE(simjson_decode_into(&PERSON_SCHEMA, &person, json_str, strlen(json_str)));
+
+    TEST_ASSERT_EQUAL_INT64(0, person.id);
+    TEST_ASSERT_NULL(person.name);
+    TEST_ASSERT_EQUAL_STRING("", person.city);
+    TEST_ASSERT_EQUAL_UINT64(0, person.score_count);
+
+    simjson_schema_free(&PERSON_SCHEMA, &person);
+}
+
+void test_simjson_decode_into_duplicate_key() {
+    //重复的键以最后一次为准，先前写入的数组与字符串需释放
+    char *json_str = "{\"scores\": [1, 2, 3], \"name\": \"Jack\", \"tags\": [\"a\", \"b\"],"
+                     " \"location\": {\"lat\": 1.5, \"lng\": 2}, \"scores\": [4, 5, 6, 7, 8, 9],"
+                     " \"name\": \"Rose\", \"tags\": [\"c\"], \"location\": {\"lng\": 3}, \"name\": null}";
+    Person person;
+    TEST_ASSERT_TRUE(simjson_decode_into(&PERSON_SCHEMA, &person, json_str, strlen(json_str)));
+
+    TEST_ASSERT_EQUAL_UINT64(6, person.score_count);
+    TEST_ASSERT_EQUAL_INT64(4, person.scores[0]);
+    TEST_ASSERT_EQUAL_INT64(9, person.scores[5]);
+    TEST_ASSERT_NULL(person.name);
+    TEST_ASSERT_EQUAL_UINT64(1, person.tag_count);
+    TEST_ASSERT_EQUAL_STRING("c", person.tags[0]);
+    TEST_ASSERT_TRUE(person.location.lat == 0);
+    TEST_ASSERT_TRUE(person.location.lng == 3);
+
+    simjson_schema_free(&PERSON_SCHEMA, &person);
+
+    json_str = "{\"name\": \"Jack\", \"name\": 1}";
+    TEST_ASSERT_FALSE(simjson_decode_into(&PERSON_SCHEMA, &person, json_str, strlen(json_str)));
+    TEST_ASSERT_NULL(person.name);
+}
+
+void test_simjson_decode_into_with_error() {
+    Person person;
+
+    char *json_str = "{\"id\": \"42\"}";
+    TEST_ASSERT_FALSE(simjson_decode_into(&PERSON_SCHEMA, &person, json_str, strlen(json_str)));
+
+    json_str = "{\"city\": \"San Francisco\"}";
+    TEST_ASSERT_FALSE(simjson_decode_into(&PERSON_SCHEMA, &person, json_str, strlen(json_str)));
+
+    json_str = "{\"age\": 3000000000}";
+    TEST_ASSERT_FALSE(simjson_decode_into(&PERSON_SCHEMA, &person, json_str, strlen(json_str)));
+
+    json_str = "{\"name\": \"Jack\", \"tags\": [\"a\", 1]}";
+    TEST_ASSERT_FALSE(simjson_decode_into(&PERSON_SCHEMA, &person, json_str, strlen(json_str)));
+    TEST_ASSERT_NULL(person.name);
+    TEST_ASSERT_NULL(person.tags);
+
+    json_str = "[1, 2]";
+    TEST_ASSERT_FALSE(simjson_decode_into(&PERSON_SCHEMA, &person, json_str, strlen(json_str)));
+
+    json_str = "{\"id\": 1} 2";
+    TEST_ASSERT_FALSE(simjson_decode_into(&PERSON_SCHEMA, &person, json_str, strlen(json_str)));
+}
+
+void test_simjson_encode_from() {
+    int64_t scores[] = {90, 85};
+    char *tags[] = {"a\"b"};
+    Location history[] = {{1, 2}};
+    Person person = {7, 30, false, "Jack", "SZ", {1.5, -2}, scores, 2, tags, 1, history, 1};
+
+    size_t length;
+    char *json_str = simjson_encode_from(&PERSON_SCHEMA, &person, &length);
+    char *expected = "{\"id\": 7, \"age\": 30, \"married\": false, \"name\": \"Jack\", \"city\": \"SZ\","
+                     " \"location\": {\"lat\": 1.5, \"lng\": -2}, \"scores\": [90, 85], \"tags\": [\"a\\\"b\"],"
+                     " \"history\": [{\"lat\": 1, \"lng\": 2}]}";
+    TEST_ASSERT_EQUAL_STRING(expected, json_str);
+    TEST_ASSERT_EQUAL_UINT64(strlen(expected), length);
+
+    //编码结果可按同一schema解码回来
+    Person decoded;
+    TEST_ASSERT_TRUE(simjson_decode_into(&PERSON_SCHEMA, &decoded, json_str, length));
+    TEST_ASSERT_EQUAL_STRING("a\"b", decoded.tags[0]);
+    TEST_ASSERT_EQUAL_INT64(85, decoded.scores[1]);
+    simjson_schema_free(&PERSON_SCHEMA, &decoded);
+
+    free(json_str);
+
+    person.name = NULL;
+    person.score_count = 0;
+    json_str = simjson_encode_from(&PERSON_SCHEMA, &person, NULL);
+    TEST_ASSERT_NOT_NULL(strstr(json_str, "\"name\": null"));
+    TEST_ASSERT_NOT_NULL(strstr(json_str, "\"scores\": []"));
+    free(json_str);
+}
+
+void test_simjson_encode_from_ex() {
+    int64_t scores[] = {90, 85};
+    char *tags[] = {"x"};
+    Person person = {7, 30, true, "Jack", "SZ", {1.5, -2}, scores, 2, tags, 1, NULL, 0};
+
+    //options为NULL时与simjson_encode_from相同
+    char *json_str = simjson_encode_from_ex(&PERSON_SCHEMA, &person, NULL, NULL);
+    char *default_str = simjson_encode_from(&PERSON_SCHEMA, &person, NULL);
+    TEST_ASSERT_EQUAL_STRING(default_str, json_str);
+    free(json_str);
+    free(default_str);
+
+    SimjsonEncodeOptions compact = {SIMJSON_ENCODE_COMPACT, 0};
+    size_t length;
+    json_str = simjson_encode_from_ex(&PERSON_SCHEMA, &person, &compact, &length);
+    char *expected = "{\"id\":7,\"age\":30,\"married\":true,\"name\":\"Jack\",\"city\":\"SZ\","
+                     "\"location\":{\"lat\":1.5,\"lng\":-2},\"scores\":[90,85],\"tags\":[\"x\"],\"history\":[]}";
+    TEST_ASSERT_EQUAL_STRING(expected, json_str);
+    TEST_ASSERT_EQUAL_UINT64(strlen(expected), length);
+    free(json_str);
+
+    //canonical模式下字段按名称排序
+    SimjsonEncodeOptions canonical = {SIMJSON_ENCODE_CANONICAL, 0};
+    json_str = simjson_encode_from_ex(&PERSON_SCHEMA, &person, &canonical, NULL);
+    expected = "{\"age\":30,\"city\":\"SZ\",\"history\":[],\"id\":7,\"location\":{\"lat\":1.5,\"lng\":-2},"
+               "\"married\":true,\"name\":\"Jack\",\"scores\":[90,85],\"tags\":[\"x\"]}";
+    TEST_ASSERT_EQUAL_STRING(expected, json_str);
+    free(json_str);
+
+    //美化输出与经由json对象编码的结果一致
+    SimjsonEncodeOptions pretty = {SIMJSON_ENCODE_PRETTY, 2};
+    json_str = simjson_encode_from_ex(&PERSON_SCHEMA, &person, &pretty, NULL);
+    char *compact_str = simjson_encode_from_ex(&PERSON_SCHEMA, &person, &compact, NULL);
+    void *json_struct = simjson_decode(compact_str, strlen(compact_str));
+    char *pretty_str = simjson_encode_ex(json_struct, &pretty, NULL);
+    TEST_ASSERT_EQUAL_STRING(pretty_str, json_str);
+    TEST_ASSERT_NOT_NULL(strstr(json_str, "{\n  \"id\": 7,\n"));
+    free(json_str);
+    free(compact_str);
+    free(pretty_str);
+    simjson_free_json_struct(json_struct);
+
+    SimjsonEncodeOptions unknown = {42, 0};
+    TEST_ASSERT_NULL(simjson_encode_from_ex(&PERSON_SCHEMA, &person, &unknown, NULL));
+}
+
+int main() {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_simjson_decode_into);
+    RUN_TEST(test_simjson_decode_into_missing_and_null);
+    RUN_TEST(test_simjson_decode_into_duplicate_key);
+    RUN_TEST(test_simjson_decode_into_with_error);
+    RUN_TEST(test_simjson_encode_from);
+    RUN_TEST(test_simjson_encode_from_ex);
+
+    return UNITY_END();
+}
@@ -25,6 +25,19 @@ void test_simjson_string_new_with_empty_str() {
     simjson_string_free(string);
 }
 
+void test_simjson_string_new_borrowed() {
+    char str[] = "Hello World!";
+    SimjsonString *string = simjson_string_new_borrowed(str, strlen(str));
+
+    TEST_ASSERT_TRUE(SIMJSON_IS_STRING_TYPE(string));
+    TEST_ASSERT_TRUE(string->borrowed);
+    TEST_ASSERT_EQUAL_PTR(str, string->value);
+    TEST_ASSERT_EQUAL_UINT64(strlen(str), string->length);
+
+    simjson_string_free(string);
+    TEST_ASSERT_EQUAL_STRING("Hello World!", str);
+}
+
 void test_simjson_new_with_null_str() {
     SimjsonString *string = simjson_string_new(NULL, 0);
     TEST_ASSERT_NULL(string);
@@ -35,7 +48,8 @@ int main() {
 
     RUN_TEST(test_simjson_string_new);
     RUN_TEST(test_simjson_string_new_with_empty_str);
+    RUN_TEST(test_simjson_string_new_borrowed);
     RUN_TEST(test_simjson_new_with_null_str);
 
-    UNITY_END();
+    return UNITY_END();
 }
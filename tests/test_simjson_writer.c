@@ -0,0 +1,112 @@
+#include <stdlib.h>
+
+#include "unity.h"
+#include "simjson.h"
+
+typedef struct {
+    char buf[256];
+    size_t length;
+    size_t calls;
+} SinkBuf;
+
+static bool sink_buf_write(void *ctx, const char *data, size_t length) {
+    SinkBuf *sink_buf = (SinkBuf *) ctx;
+    if (sink_buf->length + length >= sizeof(sink_buf->buf)) {
+        return false;
+    }
+    memcpy(sink_buf->buf + sink_buf->length, data, length);
+    sink_buf->length += length;
+    sink_buf->buf[sink_buf->length] = '\0';
+    sink_buf->calls++;
+    return true;
+}
+
+void test_simjson_writer() {
+    SimjsonWriter *writer = simjson_writer_new(NULL, NULL, 0);
+
+    TEST_ASSERT_TRUE(simjson_writer_begin_object(writer));
+    TEST_ASSERT_TRUE(simjson_writer_key(writer, "name", 4));
+    TEST_ASSERT_TRUE(simjson_writer_string(writer, "Ja\"ck", 5));
+    TEST_ASSERT_TRUE(simjson_writer_key(writer, "info", 4));
+    TEST_ASSERT_TRUE(simjson_writer_begin_array(writer));
+    TEST_ASSERT_TRUE(simjson_writer_integer(writer, 170));
+    TEST_ASSERT_TRUE(simjson_writer_double(writer, 65.5));
+    TEST_ASSERT_TRUE(simjson_writer_boolean(writer, true));
+    TEST_ASSERT_TRUE(simjson_writer_null(writer));
+    TEST_ASSERT_TRUE(simjson_writer_begin_object(writer));
+    TEST_ASSERT_TRUE(simjson_writer_end_object(writer));
+    TEST_ASSERT_TRUE(simjson_writer_end_array(writer));
+    TEST_ASSERT_TRUE(simjson_writer_end_object(writer));
+    TEST_ASSERT_TRUE(simjson_writer_finish(writer));
+
+    size_t length;
+    const char *json_str = simjson_writer_data(writer, &length);
+    char *expected = "{\"name\": \"Ja\\\"ck\", \"info\": [170, 65.5, true, null, {}]}";
+    TEST_ASSERT_EQUAL_STRING(expected, json_str);
+    TEST_ASSERT_EQUAL_UINT64(strlen(expected), length);
+
+    simjson_writer_free(writer);
+}
+
+void test_simjson_writer_with_sink() {
+    SinkBuf sink_buf = {{0}, 0, 0};
+    SimjsonWriter *writer = simjson_writer_new(sink_buf_write, &sink_buf, 8);
+
+    TEST_ASSERT_TRUE(simjson_writer_begin_array(writer));
+    for (int64_t i = 0; i < 10; i++) {
+        TEST_ASSERT_TRUE(simjson_writer_integer(writer, i));
+    }
+    TEST_ASSERT_TRUE(simjson_writer_string(writer, "a long string value", 19));
+    TEST_ASSERT_TRUE(simjson_writer_end_array(writer));
+    TEST_ASSERT_TRUE(simjson_writer_finish(writer));
+
+    TEST_ASSERT_EQUAL_STRING("[0, 1, 2, 3, 4, 5, 6, 7, 8, 9, \"a long string value\"]", sink_buf.buf);
+    TEST_ASSERT_TRUE(sink_buf.calls > 1);
+    TEST_ASSERT_NULL(simjson_writer_data(writer, NULL));
+
+    simjson_writer_free(writer);
+}
+
+void test_simjson_writer_with_misuse() {
+    SimjsonWriter *writer = simjson_writer_new(NULL, NULL, 0);
+    TEST_ASSERT_TRUE(simjson_writer_begin_object(writer));
+    TEST_ASSERT_FALSE(simjson_writer_integer(writer, 1));
+    //出错后不再接受写入
+    TEST_ASSERT_FALSE(simjson_writer_key(writer, "a", 1));
+    simjson_writer_free(writer);
+
+    writer = simjson_writer_new(NULL, NULL, 0);
+    TEST_ASSERT_TRUE(simjson_writer_begin_array(writer));
+    TEST_ASSERT_FALSE(simjson_writer_end_object(writer));
+    simjson_writer_free(writer);
+
+    writer = simjson_writer_new(NULL, NULL, 0);
+    TEST_ASSERT_FALSE(simjson_writer_key(writer, "a", 1));
+    simjson_writer_free(writer);
+
+    writer = simjson_writer_new(NULL, NULL, 0);
+    TEST_ASSERT_TRUE(simjson_writer_begin_object(writer));
+    TEST_ASSERT_TRUE(simjson_writer_key(writer, "a", 1));
+    TEST_ASSERT_FALSE(simjson_writer_end_object(writer));
+    simjson_writer_free(writer);
+
+    writer = simjson_writer_new(NULL, NULL, 0);
+    TEST_ASSERT_TRUE(simjson_writer_integer(writer, 1));
+    TEST_ASSERT_FALSE(simjson_writer_integer(writer, 2));
+    simjson_writer_free(writer);
+
+    writer = simjson_writer_new(NULL, NULL, 0);
+    TEST_ASSERT_TRUE(simjson_writer_begin_array(writer));
+    TEST_ASSERT_FALSE(simjson_writer_finish(writer));
+    simjson_writer_free(writer);
+}
+
+int main() {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_simjson_writer);
+    RUN_TEST(test_simjson_writer_with_sink);
+    RUN_TEST(test_simjson_writer_with_misuse);
+
+    return UNITY_END();
+}